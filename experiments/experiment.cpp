@@ -3,9 +3,11 @@
 //
 
 #include "../include/database.h"
+#include "../include/buffer_pool/buffer_pool_manager.h"
 
 #include <iostream>
 #include <random>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -39,16 +41,48 @@ vector<int64_t> GenerateQueries(const vector<int64_t> &data, size_t query_size)
     return vector<int64_t>(shuffled_data.begin(), shuffled_data.begin() + query_size);
 }
 
-double MeasurePutThroughput(Database &db, const size_t data_step) {
+double MeasurePutThroughput(Database &db, const size_t data_step, double &p99_latency_us) {
     // Generate data
     // For each iteration, insert data_size number of data
     vector<int64_t> data = GenerateUniformData(data_step, 1, 1e9);
 
+    // Latency of every Put, flushes happen in the background and should not show up in the tail
+    vector<double> latencies_us;
+    latencies_us.reserve(data.size());
+
     const auto start = chrono::high_resolution_clock::now();
     // Insert data
     for (const auto i: data) {
+        const auto put_start = chrono::high_resolution_clock::now();
         db.Put(i, i);
+        const chrono::duration<double, micro> put_duration = chrono::high_resolution_clock::now() - put_start;
+        latencies_us.push_back(put_duration.count());
+    }
+
+    const auto end = chrono::high_resolution_clock::now();
+    const chrono::duration<double> duration = end - start;
+
+    const auto p99 = latencies_us.begin() + latencies_us.size() * 99 / 100;
+    ranges::nth_element(latencies_us, p99);
+    p99_latency_us = *p99;
+
+    return data.size() / duration.count(); // Inserts per second
+}
+
+double MeasureWriteBatchThroughput(Database &db, const size_t data_step, const size_t batch_size) {
+    vector<int64_t> data = GenerateUniformData(data_step, 1, 1e9);
+
+    const auto start = chrono::high_resolution_clock::now();
+    // Insert data, batch_size keys per write
+    WriteBatch batch;
+    for (const auto i: data) {
+        batch.Put(i, i);
+        if (batch.Count() == batch_size) {
+            db.Write(batch);
+            batch.Clear();
+        }
     }
+    db.Write(batch);
 
     const auto end = chrono::high_resolution_clock::now();
     const chrono::duration<double> duration = end - start;
@@ -73,6 +107,44 @@ double MeasureBinarySearchThroughput(const Database &db, const vector<int64_t> &
     return queries.size() / duration.count(); // Queries per second
 }
 
+double MeasureMultiGetThroughput(const Database &db, const vector<int64_t> &queries, const size_t batch_size) {
+    const auto start = chrono::high_resolution_clock::now();
+
+    // Look up batch_size keys at a time
+    for (size_t i = 0; i < queries.size(); i += batch_size) {
+        const span batch(queries.data() + i, min(batch_size, queries.size() - i));
+        vector<optional<int64_t>> results = db.MultiGet(batch);
+    }
+
+    const auto end = chrono::high_resolution_clock::now();
+    const chrono::duration<double> duration = end - start;
+
+    return queries.size() / duration.count(); // Queries per second
+}
+
+double MeasureConcurrentGetThroughput(const Database &db, const vector<int64_t> &queries, const size_t num_threads) {
+    const auto start = chrono::high_resolution_clock::now();
+
+    // Every thread looks up all the queries, starting from a different one
+    vector<thread> threads;
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&db, &queries, t, num_threads] {
+            const size_t first = queries.size() * t / num_threads;
+            for (size_t i = 0; i < queries.size(); ++i) {
+                optional<int64_t> result = db.Get(queries[(first + i) % queries.size()]);
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+
+    const auto end = chrono::high_resolution_clock::now();
+    const chrono::duration<double> duration = end - start;
+
+    return queries.size() * num_threads / duration.count(); // Queries per second over all threads
+}
+
 double MeasureScanThroughput(Database &db, const vector<int64_t> &queries) {
     const auto start = chrono::high_resolution_clock::now();
 
@@ -88,26 +160,41 @@ double MeasureScanThroughput(Database &db, const vector<int64_t> &queries) {
     return queries.size() / duration.count(); // Queries per second
 }
 
-void Experiment() {
+void Experiment(const Options &options, const string &suffix) {
     cout << "Prepare for experiment" << endl;
 
     constexpr size_t query_count = 1000;
+    constexpr size_t write_batch_size = 1000;
+    constexpr size_t multi_get_batch_size = 100;
+    const vector<size_t> read_thread_counts = {1, 2, 4, 8};
 
     const string db_name = "db_experiment";
     // Remove the database file if it exists
     filesystem::remove_all(db_name);
 
-    Database db(kMemtableSize);
+    Database db(kMemtableSize, options);
     db.Open(db_name);
 
     // Initialize output files
-    ofstream outPut("experiment_Put.csv");
+    ofstream outPut("experiment_Put" + suffix + ".csv");
     outPut << "Data Size,Put Throughput" << endl;
 
-    ofstream outGet("experiment_Get.csv");
+    ofstream outPutLatency("experiment_Put_p99" + suffix + ".csv");
+    outPutLatency << "Data Size,Put p99 Latency (us)" << endl;
+
+    ofstream outWriteBatch("experiment_WriteBatch" + suffix + ".csv");
+    outWriteBatch << "Data Size,Write Batch Throughput" << endl;
+
+    ofstream outGet("experiment_Get" + suffix + ".csv");
     outGet << "Data Size,Binary Search Throughput" << endl;
 
-    ofstream outScan("experiment_Scan.csv");
+    ofstream outMultiGet("experiment_MultiGet" + suffix + ".csv");
+    outMultiGet << "Data Size,MultiGet Throughput" << endl;
+
+    ofstream outConcurrentGet("experiment_ConcurrentGet" + suffix + ".csv");
+    outConcurrentGet << "Data Size,Threads,Get Throughput" << endl;
+
+    ofstream outScan("experiment_Scan" + suffix + ".csv");
     outScan << "Data Size,Scan Throughput" << endl;
 
     constexpr size_t max_exponent = 10;
@@ -124,9 +211,20 @@ void Experiment() {
 
         // Measure Put throughput
         // For each iteration, increment data size is the half of current data size
-        double put_throughput = MeasurePutThroughput(db, increment_pairs);
+        // Half of the increment is put one key at a time, the other half in batches
+        double put_p99_latency;
+        double put_throughput = MeasurePutThroughput(db, increment_pairs / 2, put_p99_latency);
         cout << "Put throughput: " << put_throughput << " inserts per second. Data size (MB): " << data_size_mb << endl;
         outPut << data_size_mb << "," << to_string(put_throughput) << endl;
+        cout << "Put p99 latency: " << put_p99_latency << " us. Data size (MB): " << data_size_mb << endl;
+        outPutLatency << data_size_mb << "," << to_string(put_p99_latency) << endl;
+
+        // Measure Write Batch throughput
+        double write_batch_throughput =
+                MeasureWriteBatchThroughput(db, increment_pairs - increment_pairs / 2, write_batch_size);
+        cout << "Write batch throughput: " << write_batch_throughput << " inserts per second. Data size (MB): "
+             << data_size_mb << endl;
+        outWriteBatch << data_size_mb << "," << to_string(write_batch_throughput) << endl;
 
         // Generate queries
         vector<int64_t> queries = GenerateUniformData(query_count, 1, 1e9);
@@ -137,6 +235,21 @@ void Experiment() {
              << " queries per second. Data size (MB): " << data_size_mb << endl;
         outGet << data_size_mb << "," << to_string(binary_search_throughput) << endl;
 
+        // Measure MultiGet throughput, the same queries looked up multi_get_batch_size at a time
+        double multi_get_throughput = MeasureMultiGetThroughput(db, queries, multi_get_batch_size);
+        cout << "MultiGet throughput: " << multi_get_throughput << " queries per second. Data size (MB): "
+             << data_size_mb << endl;
+        outMultiGet << data_size_mb << "," << to_string(multi_get_throughput) << endl;
+
+        // Measure Get throughput of several reader threads sharing the buffer pool
+        for (const size_t num_threads: read_thread_counts) {
+            double concurrent_get_throughput = MeasureConcurrentGetThroughput(db, queries, num_threads);
+            cout << "Get throughput of " << num_threads << " threads: " << concurrent_get_throughput
+                 << " queries per second. Data size (MB): " << data_size_mb << endl;
+            outConcurrentGet << data_size_mb << "," << num_threads << "," << to_string(concurrent_get_throughput)
+                             << endl;
+        }
+
         // Measure Scan throughput
         double scan_throughput = MeasureScanThroughput(db, queries);
         cout << "Scan throughput: " << scan_throughput << " queries per second. Data size (MB): " << data_size_mb
@@ -150,9 +263,144 @@ void Experiment() {
     cout << "Experiment completed" << endl;
 }
 
-int main() {
+// One read of the eviction policy workload, a Get of key, or a Scan of [key, key + scan_length)
+struct ReadOp {
+    bool is_scan;
+    int64_t key;
+};
+
+// Point lookups mostly of a hot key range, mixed with short scans anywhere in the key space
+vector<ReadOp> GenerateReadWorkload(const size_t num_ops, const int64_t num_keys, const int64_t scan_length) {
+    // Same seed for every policy, each replays the same reads
+    mt19937_64 gen(42);
+    uniform_real_distribution<double> coin(0, 1);
+    uniform_int_distribution<int64_t> any_key(0, num_keys - scan_length);
+    uniform_int_distribution<int64_t> hot_key(0, num_keys / 20); // first 5% of the keys
+
+    vector<ReadOp> ops;
+    for (size_t i = 0; i < num_ops; ++i) {
+        if (coin(gen) < 0.1) {
+            ops.push_back({true, any_key(gen)});
+        } else {
+            ops.push_back({false, coin(gen) < 0.8 ? hot_key(gen) : any_key(gen)});
+        }
+    }
+    return ops;
+}
+
+double MeasureReadWorkloadThroughput(Database &db, const vector<ReadOp> &ops, const int64_t scan_length) {
+    const auto start = chrono::high_resolution_clock::now();
+
+    for (const auto &[is_scan, key]: ops) {
+        if (is_scan) {
+            vector<pair<int64_t, int64_t>> result = db.Scan(key, key + scan_length - 1);
+        } else {
+            optional<int64_t> result = db.Get(key);
+        }
+    }
+
+    const auto end = chrono::high_resolution_clock::now();
+    const chrono::duration<double> duration = end - start;
+
+    return ops.size() / duration.count(); // Reads per second
+}
+
+// Replays the same Get/Scan workload against every eviction policy of the buffer pool
+// The buffer pool caches about 1/8 of the leaves, scans of 16 leaves are short enough to go through it
+void EvictionPolicyExperiment() {
+    cout << "Prepare for eviction policy experiment" << endl;
+
+    constexpr size_t pool_size = 1024 * kPageSize; // 4MB
+    constexpr int64_t num_keys = 8192 * kPagePairs; // 32MB
+    constexpr int64_t scan_length = 16 * kPagePairs;
+    constexpr size_t warmup_ops = 20000;
+    constexpr size_t num_ops = 100000;
+
+    BufferPool *buffer_pool = BufferPoolManager::GetInstance();
+
+    const string db_name = "db_experiment";
+    filesystem::remove_all(db_name);
+
+    Options options;
+    options.wal_sync_mode = WalSyncMode::kNever;
+    options.buffer_pool_size = pool_size;
+    Database db(kMemtableSize, options);
+    db.Open(db_name);
+    for (int64_t key = 0; key < num_keys; key += 1000) {
+        WriteBatch batch;
+        for (int64_t i = key; i < min(key + 1000, num_keys); ++i) {
+            batch.Put(i, i * 10);
+        }
+        db.Write(batch);
+    }
+
+    // Reopen once every merge is done, the SSTs no longer change under the reads
+    db.Close();
+    db.Open(db_name);
+
+    const vector<ReadOp> warmup = GenerateReadWorkload(warmup_ops, num_keys, scan_length);
+    const vector<ReadOp> ops = GenerateReadWorkload(num_ops, num_keys, scan_length);
+
+    ofstream outEviction("experiment_EvictionPolicy.csv");
+    outEviction << "Policy,Hit Rate,Read Throughput" << endl;
+
+    const vector<pair<EvictionPolicyType, string>> policies = {
+            {EvictionPolicyType::kLRU, "LRU"},
+            {EvictionPolicyType::kClock, "CLOCK"},
+            {EvictionPolicyType::kTwoQ, "2Q"},
+            {EvictionPolicyType::kLRUK, "LRU-2"},
+    };
+    for (const auto &[policy_type, policy_name]: policies) {
+        buffer_pool->SetEvictionPolicy(policy_type);
+        buffer_pool->Clear();
+        MeasureReadWorkloadThroughput(db, warmup, scan_length);
+
+        buffer_pool->ResetStats();
+        const double throughput = MeasureReadWorkloadThroughput(db, ops, scan_length);
+        const double hit_rate = buffer_pool->HitRate();
+
+        cout << policy_name << " hit rate: " << hit_rate << ", throughput: " << throughput << " reads per second"
+             << endl;
+        outEviction << policy_name << "," << to_string(hit_rate) << "," << to_string(throughput) << endl;
+    }
+    db.Close();
+
+    cout << "Experiment completed" << endl;
+}
+
+int main(const int argc, char *argv[]) {
     // When only performing Binary search on B-Tree,
     // Experiment 2 is exactly the same as that of the Get Throughput in Experiment 3
 
-    Experiment();
+    // "./kv-experiment mmap" reads SSTs through mmap instead of the buffer pool,
+    // results are written to experiment_*_mmap.csv to compare with the default run
+    // "./kv-experiment direct" reads and writes pages with O_DIRECT, the page cache of the kernel does not
+    // help the reads, results are written to experiment_*_direct.csv
+    // "./kv-experiment bitpacked" bit-packs the leaves of every level but level 0, results are written to
+    // experiment_*_bitpacked.csv
+    // "./kv-experiment eviction" compares the hit rates of the eviction policies of the buffer pool instead,
+    // results are written to experiment_EvictionPolicy.csv
+    if (argc > 1 && string(argv[1]) == "eviction") {
+        EvictionPolicyExperiment();
+        return 0;
+    }
+
+    Options options;
+    string suffix;
+    if (argc > 1 && string(argv[1]) == "mmap") {
+        options.read_mode = ReadMode::kMmap;
+        suffix = "_mmap";
+    } else if (argc > 1 && string(argv[1]) == "direct") {
+        options.read_mode = ReadMode::kDirectIO;
+        suffix = "_direct";
+    } else if (argc > 1 && string(argv[1]) == "bitpacked") {
+        options.leaf_formats.assign(kLevelToApplyDostoevsky + 1, LeafFormat::kBitPacked);
+        options.leaf_formats[0] = LeafFormat::kRaw;
+        suffix = "_bitpacked";
+    } else if (argc > 1 && string(argv[1]) == "columnar") {
+        options.leaf_formats.assign(kLevelToApplyDostoevsky + 1, LeafFormat::kColumnar);
+        suffix = "_columnar";
+    }
+
+    Experiment(options, suffix);
 }
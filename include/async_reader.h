@@ -0,0 +1,81 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#ifndef ASYNC_READER_H
+#define ASYNC_READER_H
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// One read of a batch, result is the number of bytes read, or -errno on failure
+struct ReadRequest {
+    int fd;
+    void *buffer;
+    size_t size;
+    off_t offset;
+    ssize_t result = 0;
+};
+
+// Reads a batch of pages with all the reads in flight at once, so the latency of the device is paid once per batch
+// instead of once per page
+class AsyncReader {
+public:
+    virtual ~AsyncReader() = default;
+
+    // io_uring when the kernel has it, else a pool of threads calling pread
+    static AsyncReader &GetInstance();
+
+    // Returns once every read is done, results are set in requests
+    virtual void ReadAll(span<ReadRequest> requests) = 0;
+};
+
+// Submits the reads of a batch to an io_uring with one syscall and waits for all of them with the same syscall
+// Every thread has its own ring, set up on its first batch, so threads never wait for each other
+class IoUringReader : public AsyncReader {
+public:
+    // False when the kernel has no io_uring or forbids it, as in some containers
+    static bool IsSupported();
+
+    void ReadAll(span<ReadRequest> requests) override;
+};
+
+// Hands the reads of a batch to kIoThreads threads calling pread
+class ThreadPoolReader : public AsyncReader {
+    struct Batch {
+        size_t num_pending;
+        mutex mutex_;
+        condition_variable cv_;
+    };
+
+    vector<thread> threads_;
+
+    // Guards queue_ and is_stopping_
+    mutex mutex_;
+    condition_variable cv_;
+    deque<pair<ReadRequest *, Batch *>> queue_;
+    bool is_stopping_ = false;
+
+public:
+    explicit ThreadPoolReader(size_t num_threads);
+    ~ThreadPoolReader() override;
+
+    ThreadPoolReader(const ThreadPoolReader &) = delete;
+    ThreadPoolReader &operator=(const ThreadPoolReader &) = delete;
+
+    void ReadAll(span<ReadRequest> requests) override;
+
+private:
+    // Body of the threads, reads until the reader is destroyed
+    void ReadLoop();
+};
+
+
+#endif // ASYNC_READER_H
@@ -4,27 +4,86 @@
 
 #ifndef B_TREE_H
 #define B_TREE_H
-#include <sys/_types/_off_t.h>
+#include <sys/types.h>
+
 #include "../buffer_pool/page.h"
 #include "../memtable.h"
 #include "../sstable.h"
 
 class BTreeSSTable : public SSTable {
+    friend class BTreeSSTableBuilder;
+
 public:
     vector<int64_t> root_;
     vector<vector<int64_t>> internal_nodes_;
 
+    // Leaf pages take [leaf_start_offset_, leaf_end_offset_) of the file, followed by the bloom filter and the footer
+    off_t leaf_start_offset_ = 0;
+    off_t leaf_end_offset_ = 0;
+
+    // Number of the flush or merge that wrote the SST, the parts of a merge split into key sub-ranges share it
+    // SSTs of a run have disjoint key ranges, a level is full once it holds enough runs
+    int64_t run_ = 0;
+
     // Default level set to 0, as it is the first level of the B-Tree
     BTreeSSTable(const string &db_name, bool create_new, int64_t level = 0);
 
-    void WritePage(const off_t offset, const Page *page, bool is_final_page) const;
+    // Creates an SST of run of level, part is set when the merge writing it is split into key sub-ranges
+    BTreeSSTable(const string &db_name, int64_t level, int64_t run, optional<size_t> part);
+
+    // Number of key-value pairs, tombstones included
+    size_t num_pairs_ = 0;
 
-    string FlushToStorage(const vector<int64_t> *data);
+    // References of the LSM-Tree and of the iterators reading the SST, see LsmTree::Ref
+    atomic<size_t> num_refs_ = 1;
+
+    // Set when a merge drops the SST from the LSM-Tree, its pages and file go with the last reference
+    bool is_obsolete_ = false;
+
+    // Writes the page at offset, and hands it over to the buffer pool if should_cache
+    // Leaves of a bit-packed SST are written encoded and cached decoded, returns the number of bytes written
+    size_t WritePage(const off_t offset, Page page, bool should_cache = true) const;
+
+    // Writes the sorted key-value pairs of data to the new SST, see BTreeSSTableBuilder to write them one at a time
+    string FlushToStorage(const vector<int64_t> *data, LeafFormat leaf_format = LeafFormat::kRaw);
 
     void GenerateBTreeLayers(vector<int64_t> prev_layer_nodes);
     off_t ReadOffset() const;
 
+    // Returns the index of the leaf page that may contain key, or nullopt if key is greater than all keys
+    optional<size_t> FindLeaf(int64_t key) const;
+
+    // Looks up keys sorted in ascending order, every leaf page is read and searched once for all the keys it may hold
+    // Tombstones are returned as INT64_MIN values, like Get
+    vector<optional<int64_t>> MultiGet(const vector<int64_t> &keys) const;
+
+    // Number of leaves from the one holding start_key to the one holding end_key, found through the index in memory
+    size_t EstimateScanPages(int64_t start_key, int64_t end_key) const override;
+
+    // End of the leaf holding end_key, found through the index in memory
+    off_t ScanEndOffset(int64_t end_key) const override;
+
+    // Most pairs a leaf of the SST holds
+    size_t MaxLeafPairs() const {
+        return leaf_format_ == LeafFormat::kBitPacked ? kMaxBitPackedLeafPairs : kPagePairs;
+    }
+
 private:
+    void CreateFile(const string &db_name, const string &file_name);
+
+    off_t DataStartOffset() const override { return leaf_start_offset_; }
+    off_t DataEndOffset() const override { return leaf_end_offset_; }
+
+    // Number of pages the root node takes on storage
+    static size_t NumRootPages(size_t num_internal_nodes);
+
+    // Reads root and internal nodes into memory when an existing SST is opened
+    void LoadIndex();
+
+    // Writes the bloom filter and the footer after the leaf pages
+    void WriteFooter(off_t offset) const;
+
+    // Reads the footer back, sets the key range, the leaf range and loads the bloom filter
     void InitialKeyRange() override;
 
     // Returns the offset of startKey or nullopt if not found
@@ -0,0 +1,54 @@
+//
+// Created by Kiiro Huang on 2024-12-07.
+//
+
+#ifndef B_TREE_SSTABLE_BUILDER_H
+#define B_TREE_SSTABLE_BUILDER_H
+#include "b_tree_sstable.h"
+#include "../bit_packed_leaf.h"
+
+// Writes the key-value pairs of a new B-Tree SST in key order, each leaf page as soon as it fills
+// Only the page being filled, the last key of every leaf and the bloom filter are kept in memory
+class BTreeSSTableBuilder {
+    BTreeSSTable *sst_;
+
+    // Index pages before the first leaf are reserved for at most max_pairs_ pairs
+    size_t max_pairs_;
+
+    // Pages written are handed over to the buffer pool, merges write too much to keep
+    bool should_cache_pages_;
+    size_t num_pairs_ = 0;
+
+    off_t offset_; // offset of the leaf page being filled
+    PageData page_data_;
+
+    // A bit-packed leaf is written once the next pair would not fit, a raw one once it holds kPagePairs pairs
+    LeafFormat leaf_format_;
+    BitPackedLeaf bit_packed_leaf_;
+
+    // End of the last leaf written
+    off_t leaf_end_offset_;
+
+    // Last key of every leaf written so far, the internal and root nodes are built from them
+    vector<int64_t> last_keys_;
+
+public:
+    // The SST is newly created and empty, max_pairs bounds the number of pairs added
+    BTreeSSTableBuilder(BTreeSSTable *sst, size_t max_pairs, bool should_cache_pages = true,
+                        LeafFormat leaf_format = LeafFormat::kRaw);
+
+    // Keys are added in strictly increasing order
+    void Add(int64_t key, int64_t value);
+
+    size_t NumPairs() const { return num_pairs_; }
+
+    // Writes the last leaf, the root and internal nodes, the bloom filter and the footer
+    // Returns the file path of the SST
+    string Finish();
+
+private:
+    void FlushPage();
+};
+
+
+#endif // B_TREE_SSTABLE_BUILDER_H
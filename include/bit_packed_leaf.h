@@ -0,0 +1,50 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#ifndef BIT_PACKED_LEAF_H
+#define BIT_PACKED_LEAF_H
+#include <cstdint>
+#include <span>
+
+#include "buffer_pool/page.h"
+
+using namespace std;
+
+
+// Leaf page holding its pairs in as few bits as their ranges need, LeafFormat::kBitPacked
+// Words of a leaf:
+//   [num_pairs | key_bits << 32 | value_bits << 40] [first key] [min value]
+//   [gap to the previous key minus 1, key_bits each, for every key but the first]
+//   [value minus min value, value_bits each]
+// Both bit streams start at a new word and fill every word from its lowest bit, dense keys take 0 bits
+// Tracks the pairs added to the leaf being filled, to tell when the next pair no longer fits
+class BitPackedLeaf {
+    size_t num_pairs_ = 0;
+    int64_t last_key_ = 0;
+    uint64_t max_key_gap_ = 0;
+    int64_t min_value_ = 0;
+    int64_t max_value_ = 0;
+
+public:
+    // True if the pairs added so far and this one encode within kPageSize and kMaxBitPackedLeafPairs pairs
+    bool Fits(int64_t key, int64_t value) const;
+
+    // Keys are added in strictly increasing order
+    void Add(int64_t key, int64_t value);
+
+    void Clear() { num_pairs_ = 0; }
+
+    // Bytes of a leaf of num_pairs pairs with the given bit widths
+    static size_t EncodedBytes(size_t num_pairs, unsigned key_bits, unsigned value_bits);
+
+    // Encodes columnar key-value pairs, see LeafPage, keys strictly increasing
+    static PageData Encode(span<const int64_t> pairs);
+
+    // Decodes the words of a leaf back into columnar key-value pairs
+    // Returns false if the words are too few for what the header says
+    static bool Decode(span<const int64_t> words, PageData &pairs);
+};
+
+
+#endif // BIT_PACKED_LEAF_H
@@ -0,0 +1,45 @@
+//
+// Created by Kiiro Huang on 2024-12-02.
+//
+
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+#include <cstdint>
+#include <vector>
+
+#include "../utils/constants.h"
+
+using namespace std;
+
+class BloomFilter {
+public:
+    vector<uint64_t> bits_;
+    size_t num_hashes_ = 0;
+
+    BloomFilter() = default;
+
+    // Size the filter for num_keys keys
+    explicit BloomFilter(size_t num_keys, size_t bits_per_key = kBloomBitsPerKey);
+
+    // Rebuild a filter that was read back from storage
+    BloomFilter(vector<uint64_t> bits, size_t num_hashes);
+
+    void Put(int64_t key);
+
+    // False means the key is surely absent, true means it may be present
+    // An empty filter (e.g. SSTs without one) may contain any key
+    bool MayContain(int64_t key) const;
+
+    bool Empty() const { return bits_.empty(); }
+
+    size_t NumBits() const { return bits_.size() * 64; }
+
+    size_t SizeInBytes() const { return bits_.size() * sizeof(uint64_t); }
+
+private:
+    // Double hashing: the i-th probe is h1 + i * h2, both halves from one MurmurHash3 call
+    static void Hash(int64_t key, uint64_t &h1, uint64_t &h2);
+};
+
+
+#endif // BLOOM_FILTER_H
@@ -4,48 +4,75 @@
 
 #ifndef BUFFER_POOL_H
 #define BUFFER_POOL_H
-#include <forward_list>
-#include <string>
 #include <vector>
 
-#include "bucket_node.h"
-#include "lru/lru.h"
+#include "buffer_pool_shard.h"
 #include "page.h"
+#include "page_handle.h"
+#include "scan_ring.h"
 
 #include "../../utils/constants.h"
 
 using namespace std;
 
 
+// Pages are spread over shards by the hash of their ids
+// A page lives in exactly one shard, which latches, caches and evicts it on its own
 class BufferPool {
 
 public:
-    vector<BucketNode*> *buckets_;
+    vector<BufferPoolShard *> shards_;
 
+    // Budget in bytes, split evenly among the shards
     size_t capacity_;
-    size_t size_;
 
-    LRU *eviction_policy_;
+    EvictionPolicyType policy_type_;
 
-    explicit BufferPool(size_t capacity);
-    ~BufferPool();
+    // Frames of the pages read by large scans and merges, which never get into the shards
+    ScanRing scan_ring_;
 
-    Page *Get(const string &id) const;
+    // capacity is in bytes, num_shards is lowered so the budget of every shard holds kMinShardPages pages
+    explicit BufferPool(size_t capacity, size_t num_shards = kBufferPoolShards,
+                        EvictionPolicyType policy_type = EvictionPolicyType::kLRU);
+    ~BufferPool();
 
-    Page *Put(const string &id, const vector<int64_t> &data);
+    // Returns a pinned handle of the cached page, or an empty handle if not cached
+    PageHandle Get(PageId id) const;
 
-    void Remove();
+    // Takes over data and caches it as a page, returns a pinned handle of the cached page
+    PageHandle Put(PageId id, PageData data);
 
-    void RemoveLevel(int64_t level);
+    // Drops every page of the SST, from the shards and the scan ring, called when its file is deleted
+    void RemoveSst(uint32_t file_id);
 
+    // Drops every page, from the shards and the scan ring
     void Clear();
 
-    void Resize();
+    // Drops every page and starts over with a new eviction policy, does nothing if the policy is already in use
+    void SetEvictionPolicy(EvictionPolicyType policy_type);
 
-private:
-    Page *FindPage(const string &id) const;
+    EvictionPolicyType GetEvictionPolicy() const { return policy_type_; }
+
+    // Reads served from the cache, over all reads since the last ResetStats
+    double HitRate() const;
+
+    void ResetStats();
 
-    size_t HashFunction(const string &key) const;
+    // Sets the budget in bytes while pages are read, shrinking evicts until every shard fits in its share
+    // The number of shards stays, a shard always caches at least the page last put into it
+    void Resize(size_t capacity);
+
+    // Number of cached pages over all shards
+    size_t Size() const;
+
+    // Memory taken by the shards, within capacity_ unless pages are pinned, the scan ring is not counted
+    size_t Bytes() const;
+
+    BufferPoolShard *GetShard(PageId id) const;
+
+private:
+    // Budget of the shard_index-th of num_shards shards
+    size_t ShardCapacity(size_t shard_index, size_t num_shards) const;
 };
 
 
@@ -0,0 +1,88 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#ifndef BUFFER_POOL_SHARD_H
+#define BUFFER_POOL_SHARD_H
+#include <mutex>
+#include <vector>
+
+#include "eviction_policy.h"
+#include "frame_table.h"
+#include "page.h"
+#include "page_handle.h"
+
+using namespace std;
+
+
+// One shard of the buffer pool, caching the pages whose ids hash to it
+// Each shard has its own latch, frame table and eviction policy, threads reading pages of different shards do not contend
+class BufferPoolShard {
+
+public:
+    FrameTable frames_;
+
+    // Budget of the shard in bytes, and the number of pages cached
+    size_t capacity_;
+    size_t size_;
+
+    // Bytes of the pages cached, with their data
+    size_t page_bytes_ = 0;
+
+    EvictionPolicy *eviction_policy_;
+
+    // Reads of the shard served from the cache and not, since the last ResetStats
+    mutable size_t num_hits_ = 0;
+    mutable size_t num_misses_ = 0;
+
+    // Guards the frame table, the eviction policy and the stats
+    // Pages are shared by foreground reads and background flushes
+    mutable mutex mutex_;
+
+    // capacity is the budget of the shard in bytes
+    explicit BufferPoolShard(size_t capacity, EvictionPolicyType policy_type = EvictionPolicyType::kLRU);
+    ~BufferPoolShard();
+
+    // Returns a pinned handle of the cached page, or an empty handle if not cached
+    PageHandle Get(PageId id) const;
+
+    // Takes over data and caches it as a page, returns a pinned handle of the cached page
+    // Pages are evicted until the new one fits in the budget, it is cached over the budget if every page is pinned
+    PageHandle Put(PageId id, PageData data);
+
+    // Evicts the page picked by the eviction policy, pinned pages are never evicted
+    void Remove();
+
+    // Drops every page of the SST
+    void RemoveSst(uint32_t file_id);
+
+    void Clear();
+
+    // Drops every page and starts over with a new eviction policy
+    void SetEvictionPolicy(EvictionPolicyType policy_type);
+
+    void ResetStats();
+
+    // Sets the budget of the shard in bytes, pages are evicted until the shard fits in it
+    void Resize(size_t capacity);
+
+    size_t Size() const;
+
+    // Memory taken by the pages, the frame table and the eviction policy, within capacity_ unless pages are pinned
+    size_t Bytes() const;
+
+private:
+    // Same as Remove, with mutex_ held, returns false if no page could be evicted
+    bool RemoveLocked();
+
+    // Same as Bytes, with mutex_ held
+    size_t BytesLocked() const { return page_bytes_ + frames_.Bytes() + eviction_policy_->Bytes(); }
+
+    // Number of full pages the budget holds, sizes the history of the eviction policy
+    size_t MaxPages() const;
+
+    static size_t PageBytes(const PageData &data) { return sizeof(Page) + data.capacity() * sizeof(int64_t); }
+};
+
+
+#endif // BUFFER_POOL_SHARD_H
@@ -0,0 +1,43 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#ifndef CLOCK_H
+#define CLOCK_H
+#include "../eviction_policy.h"
+#include "../page_queue.h"
+
+using namespace std;
+
+
+class ClockNode : public QueueNode {
+public:
+    // The page was read since the hand last passed it
+    bool is_referenced_ = false;
+
+    using QueueNode::QueueNode;
+};
+
+// Second chance over a ring of pages, the front of the queue is under the hand
+// A read only sets the reference bit of the page, the queue is reordered only when a page is evicted
+class Clock : public EvictionPolicy {
+public:
+    PageQueue ring_;
+
+    ~Clock() override;
+
+    void Put(PageId key, Page *page) override;
+
+    void Touch(Page *page) override;
+
+    Page *Victim() override;
+
+    void EvictPage(Page *page) override;
+
+    void Clear() override;
+
+    size_t Bytes() const override { return ring_.size_ * sizeof(ClockNode); }
+};
+
+
+#endif // CLOCK_H
@@ -4,16 +4,53 @@
 
 #ifndef EVICTION_POLICY_H
 #define EVICTION_POLICY_H
+#include <cstddef>
 
 #include "page.h"
+#include "page_queue.h"
+#include "../options.h"
 
+// Tracks the pages cached by a buffer pool shard and picks the ones to evict
+// Called with the mutex of the shard held
 class EvictionPolicy {
 public:
-    virtual void Put(int64_t key, Page *page) = 0;
+    virtual ~EvictionPolicy() = default;
 
-    virtual void Evict() = 0;
+    // capacity is the number of pages the shard caches, policies keeping history size it from there
+    static EvictionPolicy *Create(EvictionPolicyType type, size_t capacity);
 
+    // Starts tracking a page newly cached
+    virtual void Put(PageId key, Page *page) = 0;
+
+    // The cached page is read again
+    virtual void Touch(Page *page) = 0;
+
+    // Returns the page to evict next, skipping the pages pinned by a PageHandle, or nullptr if every page is pinned
+    // The page is tracked until EvictPage is called
+    virtual Page *Victim() = 0;
+
+    // Stops tracking the page
     virtual void EvictPage(Page *page) = 0;
+
+    // Stops tracking every page
+    virtual void Clear() = 0;
+
+    // Memory taken by the nodes of the pages tracked and by the history kept, counted in the budget of the shard
+    virtual size_t Bytes() const = 0;
+
+    // The shard now caches about capacity pages, policies keeping history resize it
+    virtual void Resize(size_t /*capacity*/) {}
+
+protected:
+    // The buffer pool holds one pin of every page it caches
+    static bool IsPinned(const Page *page) { return page->pin_count_ > 1; }
+
+    // Deletes every node of the queue and unlinks their pages, pinned pages may outlive the policy
+    static void DeleteNodes(PageQueue &queue);
+
+    // Approximate memory of a node of a hash map or an ordered map holding value_size bytes
+    static constexpr size_t HashNodeBytes(const size_t value_size) { return value_size + 2 * sizeof(void *); }
+    static constexpr size_t TreeNodeBytes(const size_t value_size) { return value_size + 4 * sizeof(void *); }
 };
 
 
@@ -0,0 +1,67 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#ifndef FRAME_TABLE_H
+#define FRAME_TABLE_H
+#include <cstdint>
+#include <vector>
+
+#include "page.h"
+
+using namespace std;
+
+// Maps page ids to the pages cached in the buffer pool
+// Open addressing with linear probing, the slots are one flat array, a lookup touches a cache line or two
+// Removal shifts the following slots back instead of leaving tombstones, so probes stay short
+class FrameTable {
+    struct Slot {
+        PageId id_ = 0;
+        Page *page_ = nullptr; // nullptr when the slot is empty
+    };
+
+    vector<Slot> slots_;
+    size_t mask_; // number of slots minus 1, the number of slots is a power of 2
+    size_t size_ = 0;
+
+public:
+    FrameTable();
+
+    Page *Find(PageId id) const;
+
+    // The page is not in the table yet
+    void Insert(Page *page);
+
+    // Returns the removed page, or nullptr if not found
+    Page *Erase(PageId id);
+
+    // Calls f on every page in the table, the table is not modified during the walk
+    template<typename F>
+    void ForEach(F f) const {
+        for (const Slot &slot: slots_) {
+            if (slot.page_) {
+                f(slot.page_);
+            }
+        }
+    }
+
+    void Clear();
+
+    // Halves the number of slots as long as at most a quarter of them would be taken, once the pool is resized down
+    void Shrink();
+
+    size_t Size() const { return size_; }
+    size_t NumSlots() const { return slots_.size(); }
+
+    // Memory taken by the slots
+    size_t Bytes() const { return slots_.size() * sizeof(Slot); }
+
+private:
+    size_t Home(PageId id) const;
+
+    // Moves every page into num_slots new slots, num_slots is a power of 2 over size_
+    void Rehash(size_t num_slots);
+};
+
+
+#endif // FRAME_TABLE_H
@@ -5,36 +5,31 @@
 #ifndef LRU_H
 #define LRU_H
 #include <cstdint>
-#include <list>
 
-#include "../../../include/buffer_pool/eviction_policy.h"
-#include "queue_node.h"
+#include "../eviction_policy.h"
+#include "../page_queue.h"
 
 using namespace std;
 
 
+// Evicts the least recently used page, the front of the queue
 class LRU : public EvictionPolicy {
 public:
-    QueueNode *front_;
-    QueueNode *rear_;
+    PageQueue queue_;
 
-    size_t capacity_;
-    size_t size_ = 0;
+    ~LRU() override;
 
-    explicit LRU(size_t capacity);
-    ~LRU();
+    void Put(PageId key, Page *page) override;
 
-    void MoveToTail(QueueNode *node);
+    void Touch(Page *page) override;
 
-    bool Update(Page *page);
-
-    void Put(int64_t key, Page *page) override;
-
-    void Evict() override;
+    Page *Victim() override;
 
     void EvictPage(Page *page) override;
 
-    void Clear();
+    void Clear() override;
+
+    size_t Bytes() const override { return queue_.size_ * sizeof(QueueNode); }
 };
 
 
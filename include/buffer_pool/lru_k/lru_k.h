@@ -0,0 +1,77 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#ifndef LRU_K_H
+#define LRU_K_H
+#include <array>
+#include <deque>
+#include <map>
+#include <unordered_map>
+
+#include "../eviction_policy.h"
+#include "../queue_node.h"
+#include "../../../utils/constants.h"
+
+using namespace std;
+
+
+// Times of the last kLruK reads of a page, the most recent first, 0 for reads that did not happen
+using ReadHistory = array<uint64_t, kLruK>;
+
+class LruKNode : public QueueNode {
+public:
+    ReadHistory history_{};
+
+    using QueueNode::QueueNode;
+};
+
+// LRU-K of O'Neil, O'Neil and Weikum
+// Evicts the page whose K-th most recent read is the oldest, pages read fewer than K times first, least recent of them
+// first. A page read once by a scan is evicted before any page read K times.
+// The histories of recently evicted pages are kept, a page read again soon after its eviction is not taken as new
+class LruK : public EvictionPolicy {
+public:
+    // Pages ordered by the time of their K-th most recent read, then of their most recent read
+    map<pair<uint64_t, uint64_t>, Page *> order_;
+
+    // Histories of the pages last evicted, oldest first
+    // An entry of retained_order_ is skipped when the page was read and evicted again since
+    unordered_map<PageId, ReadHistory> retained_;
+    deque<pair<PageId, uint64_t>> retained_order_;
+    size_t max_retained_;
+
+    // Logical time, increased on every read
+    uint64_t time_ = 0;
+
+    explicit LruK(size_t capacity);
+    ~LruK() override;
+
+    void Put(PageId key, Page *page) override;
+
+    void Touch(Page *page) override;
+
+    Page *Victim() override;
+
+    void EvictPage(Page *page) override;
+
+    void Clear() override;
+
+    size_t Bytes() const override;
+
+    void Resize(size_t capacity) override;
+
+private:
+    static pair<uint64_t, uint64_t> OrderKey(const LruKNode *node) {
+        return {node->history_[kLruK - 1], node->history_[0]};
+    }
+
+    // Records a read in the history of the page and moves it to its new place in order_
+    void Read(LruKNode *node);
+
+    // Forgets the oldest histories while over max_retained_
+    void TrimRetained();
+};
+
+
+#endif // LRU_K_H
@@ -4,24 +4,80 @@
 
 #ifndef PAGE_H
 #define PAGE_H
-#include <string>
+#include <atomic>
+#include <cstdint>
+#include <new>
 #include <vector>
 
+#include "../../utils/constants.h"
+
 using namespace std;
 
+class QueueNode;
+
+// Page ids pack the file id of the SST in the upper 32 bits and the page number in the file in the lower 32 bits
+using PageId = uint64_t;
+
+inline PageId MakePageId(const uint32_t file_id, const uint32_t page_no) {
+    return static_cast<PageId>(file_id) << 32 | page_no;
+}
+
+inline uint32_t FileIdOf(const PageId id) { return static_cast<uint32_t>(id >> 32); }
+
+// Finalizer of MurmurHash3, pages of one SST differ only in the low bits of their ids
+inline uint64_t HashPageId(const PageId id) {
+    uint64_t h = id;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Allocates page data on kPageSize boundaries, so pages are read and written with O_DIRECT straight from their data
+template<typename T>
+struct PageAllocator {
+    using value_type = T;
+
+    PageAllocator() = default;
+    template<typename U>
+    explicit PageAllocator(const PageAllocator<U> &) {}
+
+    T *allocate(const size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(kPageSize))); }
+    void deallocate(T *p, size_t) { ::operator delete(p, align_val_t(kPageSize)); }
+
+    bool operator==(const PageAllocator &) const { return true; }
+};
+
+using PageData = vector<int64_t, PageAllocator<int64_t>>;
+
 class Page {
 
 public:
-    string id_;
-    vector<int64_t> data_;
+    PageId id_;
+    PageData data_;
+
+    // Node of the page in the queues of the eviction policy, nullptr when the page is not tracked
+    // Guarded by the mutex of the buffer pool shard, like the queues themselves
+    QueueNode *queue_node_ = nullptr;
 
-    int eviction_policy_key_;
+    // Number of PageHandles reading this page, plus one held by the buffer pool while it caches the page
+    // The last unpin frees the page, whichever thread it happens on
+    atomic<int> pin_count_ = 0;
 
-    Page(const string &id) : id_(id) {}
-    Page(const string &id, const vector<int64_t> &data) : id_(id), data_(data) {}
+    explicit Page(const PageId id) : id_(id) {}
+    Page(const PageId id, PageData data) : id_(id), data_(std::move(data)) {}
 
     size_t GetSize() const { return data_.size(); }
 };
 
+// Drops the pin of the buffer pool, the page is freed now or by its last PageHandle
+inline void ReleasePage(Page *page) {
+    if (page->pin_count_.fetch_sub(1, memory_order_acq_rel) == 1) {
+        delete page;
+    }
+}
+
 
 #endif // PAGE_H
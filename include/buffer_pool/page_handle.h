@@ -0,0 +1,68 @@
+//
+// Created by Kiiro Huang on 2024-12-03.
+//
+
+#ifndef PAGE_HANDLE_H
+#define PAGE_HANDLE_H
+#include <span>
+#include <utility>
+
+#include "page.h"
+
+// A read-only, pinned view of a page
+// While any handle to a page is alive, the buffer pool does not evict or free it
+// A page that is not (or no longer) cached in the buffer pool is freed by its last handle
+// Pins are atomic, handles of the same page may be released on different threads
+class PageHandle {
+    Page *page_ = nullptr;
+    span<const int64_t> data_;
+
+public:
+    PageHandle() = default;
+
+    explicit PageHandle(Page *page) : page_(page), data_(page->data_) { Pin(); }
+
+    // A page living outside the buffer pool, e.g. in a mapped SST file, which outlives the handle
+    explicit PageHandle(const span<const int64_t> data) : data_(data) {}
+
+    PageHandle(const PageHandle &other) : page_(other.page_), data_(other.data_) { Pin(); }
+
+    PageHandle(PageHandle &&other) noexcept :
+        page_(std::exchange(other.page_, nullptr)), data_(std::exchange(other.data_, {})) {}
+
+    PageHandle &operator=(PageHandle other) noexcept {
+        std::swap(page_, other.page_);
+        std::swap(data_, other.data_);
+        return *this;
+    }
+
+    ~PageHandle() { Unpin(); }
+
+    // Nullptr for pages living outside the buffer pool
+    const Page *Get() const { return page_; }
+
+    const Page *operator->() const { return page_; }
+
+    // Interleaved key-value pairs of the page
+    span<const int64_t> Data() const { return data_; }
+
+    size_t GetSize() const { return data_.size(); }
+
+    explicit operator bool() const { return page_ != nullptr || !data_.empty(); }
+
+private:
+    void Pin() const {
+        if (page_) {
+            page_->pin_count_.fetch_add(1, memory_order_relaxed);
+        }
+    }
+
+    void Unpin() const {
+        if (page_ && page_->pin_count_.fetch_sub(1, memory_order_acq_rel) == 1) {
+            delete page_;
+        }
+    }
+};
+
+
+#endif // PAGE_HANDLE_H
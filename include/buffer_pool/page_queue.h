@@ -0,0 +1,57 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#ifndef PAGE_QUEUE_H
+#define PAGE_QUEUE_H
+#include <cstddef>
+
+#include "queue_node.h"
+
+// Doubly linked queue of the nodes of cached pages, the queue does not own the nodes
+// Every operation is O(1), nodes are reached through Page::queue_node_
+class PageQueue {
+public:
+    QueueNode *front_ = nullptr;
+    QueueNode *rear_ = nullptr;
+
+    size_t size_ = 0;
+
+    void PushBack(QueueNode *node) {
+        node->prev_ = rear_;
+        node->next_ = nullptr;
+        if (rear_) {
+            rear_->next_ = node;
+        } else {
+            front_ = node;
+        }
+        rear_ = node;
+        ++size_;
+    }
+
+    void Remove(QueueNode *node) {
+        if (node->prev_) {
+            node->prev_->next_ = node->next_;
+        } else {
+            front_ = node->next_;
+        }
+        if (node->next_) {
+            node->next_->prev_ = node->prev_;
+        } else {
+            rear_ = node->prev_;
+        }
+        node->prev_ = node->next_ = nullptr;
+        --size_;
+    }
+
+    void MoveToTail(QueueNode *node) {
+        if (node == rear_) {
+            return;
+        }
+        Remove(node);
+        PushBack(node);
+    }
+};
+
+
+#endif // PAGE_QUEUE_H
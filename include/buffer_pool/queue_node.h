@@ -0,0 +1,26 @@
+//
+// Created by Kiiro Huang on 24-11-20.
+//
+
+#ifndef QUEUENODE_H
+#define QUEUENODE_H
+#include <cstdint>
+
+#include "page.h"
+
+
+// Node of a cached page in the queues of an eviction policy, policies keeping more state per page derive from it
+class QueueNode {
+public:
+    PageId key_;
+    Page *page_;
+
+    QueueNode* prev_ = nullptr;
+    QueueNode* next_ = nullptr;
+
+    QueueNode(const PageId key, Page *page) : key_(key), page_(page) {}
+    virtual ~QueueNode() = default;
+};
+
+
+#endif // QUEUENODE_H
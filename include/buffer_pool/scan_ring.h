@@ -0,0 +1,52 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#ifndef SCAN_RING_H
+#define SCAN_RING_H
+#include <mutex>
+#include <vector>
+
+#include "page.h"
+#include "page_handle.h"
+
+using namespace std;
+
+
+// A few frames taken in turn by the pages of large scans and merges, which read every page once
+// Going through the ring, these pages never push the pages of point lookups out of the buffer pool
+// The memory of a page is reused for the next one once no PageHandle reads it
+class ScanRing {
+    vector<Page *> frames_;
+    size_t hand_ = 0; // the frame taken by the next page
+
+    mutable mutex mutex_;
+
+public:
+    explicit ScanRing(size_t num_frames);
+    ~ScanRing();
+
+    ScanRing(const ScanRing &) = delete;
+    ScanRing &operator=(const ScanRing &) = delete;
+
+    // Returns a pinned handle of the page if still in the ring, or an empty handle
+    PageHandle Get(PageId id) const;
+
+    // Returns a buffer of size int64_t to read the next page into
+    // The buffer of the page under the hand is taken over when no PageHandle reads that page
+    PageData TakeBuffer(size_t size);
+
+    // Takes over data and caches it as a page in the frame under the hand, returns a pinned handle of the page
+    PageHandle Put(PageId id, PageData data);
+
+    // Drops every page of the SST
+    void RemoveSst(uint32_t file_id);
+
+    void Clear();
+
+    // Number of frames holding a page
+    size_t Size() const;
+};
+
+
+#endif // SCAN_RING_H
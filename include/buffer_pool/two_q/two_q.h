@@ -0,0 +1,70 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#ifndef TWO_Q_H
+#define TWO_Q_H
+#include <deque>
+#include <unordered_map>
+
+#include "../eviction_policy.h"
+#include "../page_queue.h"
+
+using namespace std;
+
+
+class TwoQNode : public QueueNode {
+public:
+    // The page is in the Am queue, not in the A1in queue
+    bool is_hot_ = false;
+
+    using QueueNode::QueueNode;
+};
+
+// Full 2Q of Johnson and Shasha
+// A page read for the first time goes into the FIFO queue A1in, reads while there do not move it
+// Pages evicted from A1in leave their ids in A1out, a page read again while remembered there goes into the LRU queue Am
+// Pages of a scan are read once and go through A1in without pushing the pages read again and again out of Am
+class TwoQ : public EvictionPolicy {
+public:
+    PageQueue a1in_;
+    PageQueue am_;
+
+    // Ids of the pages last evicted from A1in, oldest first, each with the number of its eviction
+    // An id read again is dropped from a1out_ids_ only, its entry in a1out_ is skipped when it comes out
+    deque<pair<PageId, uint64_t>> a1out_;
+    unordered_map<PageId, uint64_t> a1out_ids_;
+    uint64_t num_evicted_ = 0;
+
+    size_t max_a1in_;
+    size_t max_a1out_;
+
+    explicit TwoQ(size_t capacity);
+    ~TwoQ() override;
+
+    void Put(PageId key, Page *page) override;
+
+    void Touch(Page *page) override;
+
+    Page *Victim() override;
+
+    void EvictPage(Page *page) override;
+
+    void Clear() override;
+
+    size_t Bytes() const override;
+
+    void Resize(size_t capacity) override;
+
+private:
+    // The first page of the queue that is not pinned, nullptr if every page is pinned
+    static Page *FirstUnpinned(const PageQueue &queue);
+
+    void RememberEvicted(PageId key);
+
+    // Forgets the oldest ids while A1out is over max_a1out_
+    void TrimA1out();
+};
+
+
+#endif // TWO_Q_H
@@ -4,39 +4,134 @@
 
 #ifndef DATABASE_H
 #define DATABASE_H
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "buffer_pool/buffer_pool.h"
+#include "iterator.h"
+#include "lsm_tree/compaction_scheduler.h"
 #include "memtable.h"
+#include "options.h"
 #include "sstable.h"
+#include "write_ahead_log.h"
+#include "write_batch.h"
 
 using namespace std;
 namespace fs = std::filesystem;
 
 class Database {
     string db_name_;
-    Memtable *memtable_;
+    Options options_;
     BufferPool *buffer_pool_;
 
+    // Puts go to the active memtable, a full one becomes immutable and is flushed by flush_thread_
+    // Reads consult both, the immutable memtable is dropped once its SST is in the LSM-Tree
+    // Iterators share the memtables they read, a memtable lives until its last iterator is deleted
+    shared_ptr<Memtable> memtable_;
+    shared_ptr<Memtable> immutable_memtable_;
+
+    // Guards both memtables and writers_, never held while waiting for the LSM-Tree
+    mutable mutex memtable_mutex_;
+
+    // Writes are logged before they go to the memtable, the log of the immutable memtable is
+    // removed once its SST is written
+    WriteAheadLog *wal_ = nullptr;
+    int64_t immutable_log_number_ = -1;
+
+    // A batch waiting in writers_
+    struct Writer {
+        const WriteBatch *batch;
+        bool is_done = false;
+        condition_variable cv;
+
+        explicit Writer(const WriteBatch *batch) : batch(batch) {}
+    };
+
+    // Writers in arrival order, the one at the front logs the batches of the writers queued behind it
+    // with one write and one sync, then puts them into the memtable
+    deque<Writer *> writers_;
+
+    // Signals a new immutable memtable to the flush thread, and its flush to stalled writes
+    condition_variable flush_cv_;
+
+    thread flush_thread_;
+    bool is_closing_ = false;
+
+    // Merges full levels in the background while the database is open
+    CompactionScheduler *compaction_scheduler_ = nullptr;
+
 public:
-    explicit Database(size_t memtable_size);
+    explicit Database(size_t memtable_size, const Options &options = Options());
 
     ~Database();
 
     void Open(const string &db_name);
 
-    void Close() const;
+    // Flushes the memtable and waits for every background flush and merge to finish
+    void Close();
+
+    // Returns once the key is logged, synced as Options::wal_sync_mode says, and in the memtable
+    // A full memtable is flushed in the background, Put only waits when the previous one is still being flushed
+    void Put(int64_t key, int64_t value);
 
-    void Put(int64_t key, int64_t value) const;
+    // Writes every record of the batch with one log record and one memtable update, so readers and
+    // a crash see all of them or none, the memtable is flushed once the whole batch is in it
+    void Write(const WriteBatch &batch);
 
     optional<int64_t> Get(int64_t key) const;
 
+    // Returns the value of every key, in the order of keys, as Get would
+    // Keys are looked up in key order, every level is walked once and every leaf page read once for all
+    // the keys it may hold
+    vector<optional<int64_t>> MultiGet(span<const int64_t> keys) const;
+
     vector<pair<int64_t, int64_t>> Scan(int64_t start_key, int64_t end_key) const;
 
-    void Delete(int64_t key) const;
+    // Returns an iterator over all the keys of the database, not positioned until Seek is called
+    // Deleted keys are hidden, pages are only read as the iterator moves, the caller deletes it
+    // The iterator reads the database as it was when created, writes, flushes and merges go on meanwhile
+    Iterator *NewIterator(bool is_sequential_flooding = false) const;
+
+    void Delete(int64_t key);
+
+    // Sets the memory of the buffer pool in bytes while the database is open, without dropping the pages that fit
+    // Shrinking evicts pages right away, to give memory back to the host under pressure
+    void ResizeBufferPool(size_t size);
+
+private:
+    // Puts the writes of logs left by a database that was not closed into level 0, then removes the logs
+    void ReplayLogs();
+
+    // Turns the active memtable into the immutable one, waiting for the previous one to be flushed
+    // The log continues in a new file, the closed one goes with the immutable memtable
+    void ScheduleFlush(unique_lock<mutex> &lock);
+
+    // Body of flush_thread_, flushes immutable memtables until the database is closed
+    void FlushLoop();
+
+    // Writes the memtable to a new SST of level 0
+    void FlushFromMemtable(const Memtable *memtable) const;
+
+    // Stops the flush thread, then the compaction scheduler once the last flush is merged
+    void StopBackgroundWork();
+
+    // Merges the memtable and the SSTs overlapping [start_key, end_key], tombstones included
+    // When reading ahead, the SSTs read the leaves of the range ahead of the scan, see Readahead
+    // The caller holds the LSM-Tree mutex shared, the SSTs read are referenced into ssts, see LsmTree::Ref
+    // The memtables read are shared into memtables
+    Iterator *NewMergingIterator(int64_t start_key, int64_t end_key, bool is_sequential_flooding,
+                                 bool is_reading_ahead, vector<shared_ptr<const Memtable>> &memtables,
+                                 vector<BTreeSSTable *> &ssts) const;
 
-    void FlushFromMemtable() const;
+    // Number of leaves a scan of [start_key, end_key] reads from the SSTs, with the LSM-Tree mutex held
+    size_t EstimateScanPages(int64_t start_key, int64_t end_key) const;
 };
 
 #endif // DATABASE_H
@@ -0,0 +1,54 @@
+//
+// Created by Kiiro Huang on 2024-12-05.
+//
+
+#ifndef DB_ITERATOR_H
+#define DB_ITERATOR_H
+#include <memory>
+#include <vector>
+
+#include "iterator.h"
+
+using namespace std;
+
+class BTreeSSTable;
+class Memtable;
+
+// Iterator handed out by Database::NewIterator, deleted keys are hidden
+// Pages are read only as the cursor moves, one pinned page per SST at most
+class DBIterator : public Iterator {
+    Iterator *iterator_;
+
+    // Memtables read by iterator_, shared so a flushed memtable is not deleted while the iterator is alive
+    vector<shared_ptr<const Memtable>> memtables_;
+
+    // SSTs read by iterator_, referenced so merges do not delete them while the iterator is alive
+    vector<BTreeSSTable *> ssts_;
+
+public:
+    // Takes over the merging iterator of the memtables and the SSTs, and the references of its SSTs
+    DBIterator(Iterator *iterator, vector<shared_ptr<const Memtable>> memtables, vector<BTreeSSTable *> ssts) :
+        iterator_(iterator), memtables_(std::move(memtables)), ssts_(std::move(ssts)) {}
+
+    ~DBIterator() override;
+
+    DBIterator(const DBIterator &) = delete;
+    DBIterator &operator=(const DBIterator &) = delete;
+
+    bool Valid() const override { return iterator_->Valid(); }
+
+    void Seek(int64_t key) override;
+
+    void Next() override;
+
+    int64_t Key() const override { return iterator_->Key(); }
+
+    int64_t Value() const override { return iterator_->Value(); }
+
+private:
+    // Moves past the keys whose newest value is a tombstone
+    void SkipTombstones() const;
+};
+
+
+#endif // DB_ITERATOR_H
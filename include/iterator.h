@@ -0,0 +1,28 @@
+//
+// Created by Kiiro Huang on 2024-12-05.
+//
+
+#ifndef ITERATOR_H
+#define ITERATOR_H
+#include <cstdint>
+
+// Walks the key-value pairs of a source in key order
+// Tombstones (INT64_MIN values) are yielded like any other value
+class Iterator {
+public:
+    virtual ~Iterator() = default;
+
+    virtual bool Valid() const = 0;
+
+    // Positions at the first key not less than key
+    virtual void Seek(int64_t key) = 0;
+
+    virtual void Next() = 0;
+
+    // Only called when Valid()
+    virtual int64_t Key() const = 0;
+    virtual int64_t Value() const = 0;
+};
+
+
+#endif // ITERATOR_H
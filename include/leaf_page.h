@@ -0,0 +1,52 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#ifndef LEAF_PAGE_H
+#define LEAF_PAGE_H
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "buffer_pool/page.h"
+
+using namespace std;
+
+
+// Key-value pairs of a leaf page read from the buffer pool or a mapping, in either layout:
+// interleaved keys and values (LeafFormat::kRaw), or all the keys followed by all the values (every other format)
+// Searches on columnar keys compare several keys per instruction, with the widest SIMD the CPU has
+class LeafPage {
+    const int64_t *keys_ = nullptr;
+    const int64_t *values_ = nullptr;
+    size_t stride_ = 2; // distance between two keys, and two values
+    size_t num_pairs_ = 0;
+
+public:
+    LeafPage() = default;
+    LeafPage(span<const int64_t> data, bool is_columnar);
+
+    size_t NumPairs() const { return num_pairs_; }
+
+    int64_t Key(size_t index) const { return keys_[index * stride_]; }
+
+    int64_t Value(size_t index) const { return values_[index * stride_]; }
+
+    // Index of the first key not less than key from index first on, NumPairs() if none
+    size_t LowerBound(int64_t key, size_t first = 0) const;
+
+    // Index of the first key greater than key, NumPairs() if none
+    size_t UpperBound(int64_t key) const;
+
+    // Value of the key, nullopt if not in the page
+    optional<int64_t> Find(int64_t key) const;
+
+    // Copies interleaved pairs into the columnar layout
+    static PageData ToColumnar(span<const int64_t> pairs);
+
+    // Name of the search picked for this CPU, e.g. "avx2"
+    static const char *SearchName();
+};
+
+
+#endif // LEAF_PAGE_H
@@ -0,0 +1,66 @@
+//
+// Created by Kiiro Huang on 2024-12-06.
+//
+
+#ifndef COMPACTION_SCHEDULER_H
+#define COMPACTION_SCHEDULER_H
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "lsm_tree.h"
+
+using namespace std;
+
+// Merges full levels of the LSM-Tree on a pool of worker threads
+// Every worker picks the lowest level that needs merging and is not being merged, so merges of
+// different levels run concurrently while writes and reads go on
+class CompactionScheduler {
+    LsmTree &lsm_tree_;
+
+    // Every merge is split into up to this many key sub-ranges, see LsmTree::MergeLevel
+    size_t max_subcompactions_;
+
+    vector<thread> workers_;
+
+    mutex mutex_;
+    condition_variable cv_;
+
+    // Levels being merged, a merge into the last level also takes the last level
+    set<int64_t> busy_levels_;
+    size_t num_running_ = 0;
+    bool is_stopping_ = false;
+
+public:
+    CompactionScheduler(LsmTree &lsm_tree, size_t num_workers, size_t max_subcompactions = 1);
+
+    // Waits for the merges left, see Stop
+    ~CompactionScheduler();
+
+    CompactionScheduler(const CompactionScheduler &) = delete;
+    CompactionScheduler &operator=(const CompactionScheduler &) = delete;
+
+    // Called whenever SSTs are added, wakes a worker if a level needs merging
+    void Schedule();
+
+    // Blocks the flush thread while level 0 holds kLevel0StopWritesTrigger SSTs or more
+    void WaitForLevel0();
+
+    // Returns once no level needs merging and every worker has exited
+    void Stop();
+
+private:
+    void WorkerLoop();
+
+    // Lowest level that needs merging and does not conflict with a running merge, with mutex_ held
+    optional<int64_t> PickLevel() const;
+
+    // Levels a merge of level takes until it is installed
+    static vector<int64_t> LevelsOf(int64_t level);
+};
+
+
+#endif // COMPACTION_SCHEDULER_H
@@ -4,13 +4,16 @@
 
 #ifndef LSM_TREE_H
 #define LSM_TREE_H
+#include <shared_mutex>
+
 #include "../../include/b_tree/b_tree_sstable.h"
+#include "../../include/b_tree/b_tree_sstable_builder.h"
 
 
 struct HeapNode {
     int64_t key;
     int64_t value;
-    size_t page_index; // index of int64_t inside the current page
+    size_t page_index; // index of the next pair inside the current page
     size_t sst_id;
 
     bool operator>(const HeapNode &other) const {
@@ -34,21 +37,62 @@ class LsmTree {
 public:
     vector<vector<BTreeSSTable *>> levelled_sst_;
 
+    // Reads hold it shared while they use the SSTs of levelled_sst_
+    // The flush thread and the compaction workers hold it exclusively to change levelled_sst_,
+    // so an SST is deleted only when no read is using it
+    // Iterators only hold it while they reference their SSTs, see Ref
+    mutable shared_mutex mutex_;
+
+    // Format of the leaves written to each level, see Options::leaf_formats, set before any flush or merge
+    vector<LeafFormat> leaf_formats_;
+
     static LsmTree &GetInstance();
 
-    vector<int64_t> SortMerge(vector<BTreeSSTable *> *ssts, bool should_dispose_tombstone);
+    // Format of the leaves of the SSTs written to the level, raw past the levels of leaf_formats_
+    LeafFormat GetLeafFormat(int64_t level) const;
+
+    // Merges the pairs of the SSTs, oldest first, with keys in [start_key, end_key] into the builder,
+    // the newest pair of every key wins
+    // Only the current page and the window read ahead of every input are held, so memory does not grow with the
+    // size of the level
+    void SortMerge(vector<BTreeSSTable *> *ssts, bool should_dispose_tombstone, BTreeSSTableBuilder *builder,
+                   int64_t start_key = INT64_MIN, int64_t end_key = INT64_MAX);
     void AddSst(BTreeSSTable *sst);
 
-    void SortMergePreviousLevel(int64_t current_level);
+    // Number of runs in the level, the caller holds mutex_
+    size_t NumRuns(int64_t level) const;
+
+    // Whether the level holds enough runs to be merged, the caller holds mutex_
+    // Level i is merged once it has kLsmRatio^(i+1) runs, the last level once it has 2
+    bool NeedsMerge(int64_t level) const;
+
+    // Merges the oldest runs of a full level into one run of the next level, or of the last level itself
+    // The key range is split into up to max_subcompactions sub-ranges merged on their own threads
+    // Inputs are merged while reads go on, then swapped for the result in one step
+    // Merges of the same level, or of the last level and the one above it, must not run concurrently
+    void MergeLevel(int64_t level, size_t max_subcompactions = 1);
+
     void DeleteFile(BTreeSSTable *sst);
 
-    void SortMergeLastLevel();
+    // Keeps the SST alive after it is merged away, for a reader that does not hold mutex_ all along
+    // The reference is taken while holding mutex_
+    static void Ref(BTreeSSTable *sst) { sst->num_refs_.fetch_add(1, memory_order_relaxed); }
+
+    // Releases a reference, the last one deletes the SST, with its pages and file if it was merged away
+    void Unref(BTreeSSTable *sst);
 
     vector<vector<BTreeSSTable *>> ReadSSTsFromStorage();
 
+    // Reads the SSTs of the database, full levels are merged by the compaction scheduler
     void BuildLsmTree();
 
-    void OrderLsmTree();
+private:
+    // Keys splitting the inputs into sub-ranges of about the same number of leaves, found from the
+    // separators in their internal nodes, none when the merge is too small to split
+    static vector<int64_t> SplitKeys(const vector<BTreeSSTable *> &ssts, size_t max_subcompactions);
+
+    // Upper bound of the number of pairs of the SSTs with keys in [start_key, end_key]
+    static size_t MaxPairs(const vector<BTreeSSTable *> &ssts, int64_t start_key, int64_t end_key);
 };
 
 
@@ -4,14 +4,39 @@
 
 #ifndef MEMTABLE_H
 #define MEMTABLE_H
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
+
+#include "iterator.h"
 
 using namespace std;
 
 class Memtable {
-    map<int64_t, int64_t> table_;
+    friend class MemtableIterator;
+
+    // Versions of a key sort newest first, by the sequence number of the Put that wrote them
+    struct NewestFirst {
+        bool operator()(const pair<int64_t, uint64_t> &a, const pair<int64_t, uint64_t> &b) const {
+            return a.first != b.first ? a.first < b.first : a.second > b.second;
+        }
+    };
+    using Table = map<pair<int64_t, uint64_t>, int64_t, NewestFirst>;
+
+    // Every key has one version, plus the older ones an iterator may still read
+    Table table_;
+
+    // Sequence number of the last Put, and of the last Put an iterator sees
+    // Versions written after the last iterator was created are overwritten in place
+    uint64_t last_sequence_ = 0;
+    mutable uint64_t snapshot_sequence_ = 0;
+
+    // Guards the table and the sequence numbers, iterators take it for every step, not for their lifetime
+    mutable shared_mutex mutex_;
 
 public:
     size_t memtable_size_;
@@ -26,11 +51,52 @@ public:
 
     void Delete(int64_t key);
 
+    // Newest version of every key, as key-value pairs one after the other
     vector<int64_t> Traverse() const;
 
+    // No iterator may be in use
     void clear();
 
+    // Counts every version kept
     size_t Size() const;
+
+    // Walks the memtable as it is now, later Puts are not seen, nothing is copied
+    // The memtable must outlive the iterator
+    Iterator *NewIterator() const;
+};
+
+// Cursor over the versions of a memtable up to a sequence number, while Puts go on
+// Entries of a std::map stay where they are when others are inserted, so the cursor survives the Puts
+// between its steps
+class MemtableIterator : public Iterator {
+    const Memtable *memtable_;
+    uint64_t sequence_;
+
+    Memtable::Table::const_iterator it_;
+
+    // Pair at the cursor, read while holding the lock of the memtable
+    bool is_valid_ = false;
+    int64_t key_ = 0;
+    int64_t value_ = 0;
+
+public:
+    MemtableIterator(const Memtable *memtable, const uint64_t sequence) :
+        memtable_(memtable), sequence_(sequence), it_(memtable->table_.end()) {}
+
+    bool Valid() const override { return is_valid_; }
+
+    void Seek(int64_t key) override;
+
+    void Next() override;
+
+    int64_t Key() const override { return key_; }
+
+    int64_t Value() const override { return value_; }
+
+private:
+    // Moves past the versions written after sequence_, to the newest version of a key the cursor sees
+    // The caller holds the lock of the memtable
+    void SkipNewerVersions();
 };
 
 #endif // MEMTABLE_H
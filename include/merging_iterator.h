@@ -0,0 +1,61 @@
+//
+// Created by Kiiro Huang on 2024-12-05.
+//
+
+#ifndef MERGING_ITERATOR_H
+#define MERGING_ITERATOR_H
+#include <queue>
+#include <vector>
+
+#include "iterator.h"
+
+using namespace std;
+
+struct MergeNode {
+    int64_t key;
+    size_t child_id;
+
+    bool operator>(const MergeNode &other) const {
+        // Smaller Key has higher priority
+        if (key != other.key) {
+            return key > other.key;
+        }
+
+        // When same key, smaller child_id (the newer source) has higher priority
+        return child_id > other.child_id;
+    }
+};
+
+// Merges sorted sources into one sorted stream, every key is yielded once with its newest value
+// Children are ordered from the newest to the oldest, the merging iterator owns them
+class MergingIterator : public Iterator {
+    vector<Iterator *> children_;
+
+    // Current key of every valid child, the top is the key to yield and its newest source
+    priority_queue<MergeNode, vector<MergeNode>, greater<>> min_heap_;
+
+public:
+    explicit MergingIterator(vector<Iterator *> children);
+
+    ~MergingIterator() override;
+
+    MergingIterator(const MergingIterator &) = delete;
+    MergingIterator &operator=(const MergingIterator &) = delete;
+
+    bool Valid() const override { return !min_heap_.empty(); }
+
+    void Seek(int64_t key) override;
+
+    // Moves past the current key in every child, older values of the key are skipped
+    void Next() override;
+
+    int64_t Key() const override { return min_heap_.top().key; }
+
+    int64_t Value() const override { return children_[min_heap_.top().child_id]->Value(); }
+
+private:
+    void PushChild(size_t child_id);
+};
+
+
+#endif // MERGING_ITERATOR_H
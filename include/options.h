@@ -0,0 +1,86 @@
+//
+// Created by Kiiro Huang on 2024-12-04.
+//
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+#include <cstddef>
+#include <vector>
+
+#include "../utils/constants.h"
+
+// How pages of SST files are read
+enum class ReadMode {
+    // pread into pages cached by the buffer pool
+    kBufferPool,
+    // Map every SST file read-only and read pages straight from the mapping
+    kMmap,
+    // Like kBufferPool, but pages are read and written with O_DIRECT, the page cache of the kernel is bypassed
+    // and the buffer pool is the only cache of the SSTs
+    kDirectIO,
+};
+
+// How the key-value pairs of a leaf page are stored on storage, leaves are always cached decoded
+// Leaves of every format but kRaw are cached columnar, all the keys followed by all the values, see LeafPage
+enum class LeafFormat {
+    // Interleaved int64_t keys and values, 256 pairs per leaf
+    kRaw,
+    // Keys and values packed into the bits their ranges need, see BitPackedLeaf
+    // More pairs fit in a leaf, scans and merges read fewer pages, each page costs a decode when read
+    kBitPacked,
+    // 256 int64_t keys followed by their 256 int64_t values, in-page searches compare keys with SIMD
+    // Last, the format is stored in the footer of every SST
+    kColumnar,
+};
+
+// Which pages the buffer pool evicts first
+enum class EvictionPolicyType {
+    // Least recently used page
+    kLRU,
+    // Pages on a ring, the hand skips and clears the ones read since it last passed
+    kClock,
+    // Pages read once wait in a FIFO queue, only pages read again get into the LRU queue
+    kTwoQ,
+    // Page whose K-th most recent read is the oldest, pages read fewer than K times go first
+    kLRUK,
+};
+
+// When the write-ahead log is synced to storage
+enum class WalSyncMode {
+    // Every group of writes is synced before the writes return
+    kEveryWrite,
+    // The log is synced every wal_sync_interval_ms, a crash loses at most the writes of the last interval
+    kInterval,
+    // The log is left to the OS, a crash of the process loses nothing, a crash of the machine may
+    kNever,
+};
+
+// Per-database settings, defaults come from constants.h
+struct Options {
+    // Max number of SST files the table cache keeps open
+    size_t max_open_files = kMaxOpenFiles;
+
+    ReadMode read_mode = ReadMode::kBufferPool;
+
+    // Eviction policy of the buffer pool, shared by every database of the process
+    EvictionPolicyType eviction_policy = EvictionPolicyType::kLRU;
+
+    // Memory of the buffer pool in bytes, pages with their metadata, see Database::ResizeBufferPool to change it
+    size_t buffer_pool_size = kBufferPoolSize;
+
+    // Number of worker threads merging full levels, merges of different levels run concurrently
+    size_t max_background_compactions = kMaxBackgroundCompactions;
+
+    // Max number of key sub-ranges a merge is split into, each merged on its own thread
+    size_t max_subcompactions = kMaxSubcompactions;
+
+    // Format of the leaves of the SSTs written to each level, indexed by level, levels past the end are raw
+    // e.g. {kRaw, kRaw, kBitPacked} leaves the hot levels raw and packs the cold last one
+    std::vector<LeafFormat> leaf_formats;
+
+    WalSyncMode wal_sync_mode = WalSyncMode::kEveryWrite;
+    size_t wal_sync_interval_ms = kWalSyncIntervalMs;
+};
+
+
+#endif // OPTIONS_H
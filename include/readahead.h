@@ -0,0 +1,40 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#ifndef READAHEAD_H
+#define READAHEAD_H
+#include <deque>
+
+#include "sstable.h"
+
+using namespace std;
+
+
+// Reads the pages of one SST for a cursor moving forward, a window of pages at a time
+// The window starts at kReadaheadMinPages and doubles every time the cursor uses it up, up to kReadaheadMaxPages,
+// a page read out of order drops the window and starts over from the smallest one
+class Readahead {
+    const SSTable *sst_;
+    bool is_sequential_flooding_;
+
+    // Pages from end_offset_ on are only read when asked for, one at a time
+    off_t end_offset_;
+
+    size_t window_pages_ = 0; // size of the last window, 0 before the first one
+    off_t next_offset_ = -1; // offset of the page the cursor reads next when sequential
+
+    // Pinned pages of the window not read by the cursor yet, the first one at next_offset_
+    deque<PageHandle> pages_;
+
+public:
+    Readahead(const SSTable *sst, bool is_sequential_flooding, off_t end_offset);
+
+    // Returns a pinned handle of the page at offset, as SSTable::GetPage would
+    PageHandle GetPage(off_t offset);
+
+    size_t WindowPages() const { return window_pages_; }
+};
+
+
+#endif // READAHEAD_H
@@ -5,6 +5,8 @@
 #ifndef SST_COUNTER_H
 #define SST_COUNTER_H
 #include <cstdint>
+#include <mutex>
+#include <optional>
 #include <regex>
 
 using namespace std;
@@ -13,6 +15,9 @@ class SSTCounter {
     vector<int64_t> level_counters_;
     string db_name_;
 
+    // File names are generated by the flush thread and the compaction workers
+    mutable mutex mutex_;
+
     SSTCounter() : level_counters_({}){}
 
     SSTCounter(const SSTCounter &) = delete;
@@ -27,7 +32,12 @@ public:
 
     [[nodiscard]] string GetDbName() const;
 
-    string GenerateFileName(int64_t level);
+    // Files of a level are numbered in the order they are created, numbers are never reused
+    // The parts of a merge split into key sub-ranges share one number
+    int64_t GenerateIndex(int64_t level);
+
+    // Name of part of the SSTs numbered index, e.g. btree1_4-2.bin, a single SST has no part
+    static string FileName(int64_t level, int64_t index, optional<size_t> part = nullopt);
 };
 
 
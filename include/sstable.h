@@ -4,37 +4,145 @@
 
 #ifndef SSTABLE_H
 #define SSTABLE_H
+#include <atomic>
 #include <fstream>
+#include <mutex>
+#include <span>
 
+#include "bloom_filter.h"
 #include "buffer_pool/buffer_pool.h"
 #include "buffer_pool/page.h"
+#include "buffer_pool/page_handle.h"
+#include "leaf_page.h"
+#include "options.h"
 
 using namespace std;
 class SSTable {
+    friend class SSTableIterator;
 
 public:
     string file_path_;
-    off_t file_size_;
+    off_t file_size_ = 0;
 
-    mutable int fd_;
+    // Unique among the SSTs of this process, pages of the SST are keyed by it in the buffer pool
+    const uint32_t file_id_ = next_file_id_++;
+
+    // Opened on demand, the table cache closes it when too many SSTs are open
+    mutable int fd_ = -1;
+
+    // Opened with O_DIRECT on demand in ReadMode::kDirectIO, pages are read and written through it
+    // Closed along with fd_, the rest of the file (index, bloom filter, footer) goes through fd_
+    mutable int direct_fd_ = -1;
+
+    // Held while fd_ is opened, used or closed, the table cache only closes the files it can lock
+    mutable mutex file_mutex_;
+
+    // Whole file mapped read-only in ReadMode::kMmap, kept until the SST is destroyed
+    mutable atomic<const char *> mapped_data_ = nullptr;
 
     int64_t min_key_;
     int64_t max_key_;
 
+    // Resident in memory once the SST is flushed or opened
+    BloomFilter bloom_filter_;
+
+    // Pages of key-value pairs are decoded when read, they are never views of the mapping if bit-packed
+    LeafFormat leaf_format_ = LeafFormat::kRaw;
+
     SSTable() = default;
-    ~SSTable();
+    virtual ~SSTable();
+
+    // File name without the extension, e.g. btree1_0
+    string Name() const;
+
+    // Pairs of a page of key-value pairs, in the layout of leaf_format_
+    LeafPage AsLeaf(const PageHandle &page) const { return LeafPage(page.Data(), leaf_format_ != LeafFormat::kRaw); }
 
+    // Id of the page at offset in the buffer pool
+    PageId GetPageId(off_t offset) const { return MakePageId(file_id_, offset / kPageSize); }
+
+    // Returns the fd of the SST, reopening the file if the table cache has closed it
+    // The caller holds file_mutex_ for as long as it uses the fd
     int EnsureFileOpen() const;
     void CloseFile() const;
 
-    Page *GetPage(off_t offset, bool is_sequential_flooding = false) const;
+    // Closes fd_ and direct_fd_, the caller holds file_mutex_
+    void CloseFds() const;
+
+    // Returns a pinned, read-only handle of the page, served from the buffer pool when cached
+    // or straight from the mapping in ReadMode::kMmap
+    PageHandle GetPage(off_t offset, bool is_sequential_flooding = false) const;
+
+    // Returns pinned handles of the pages at the offsets of the SSTs, in order, as GetPage would
+    // The pages not cached are read together through AsyncReader, with all their reads in flight at once
+    static vector<PageHandle> GetPages(span<const pair<const SSTable *, off_t>> pages,
+                                       bool is_sequential_flooding = false);
+
+    // Returns pinned handles of num_pages pages from the offset on, fewer past the last page
+    // Every run of pages not cached is read with one preadv, each page into its own buffer
+    vector<PageHandle> ReadPages(off_t offset, size_t num_pages, bool is_sequential_flooding = false) const;
+
+    // Gives the kernel an madvise hint (e.g. MADV_SEQUENTIAL) for [begin, end) of a mapped SST
+    void Advise(off_t begin, off_t end, int advice) const;
+
+    // False if the key is out of [min_key_, max_key_] or filtered out by the bloom filter
+    bool MayContain(int64_t key) const;
 
     optional<int64_t> Get(int64_t key) const;
     vector<pair<int64_t, int64_t>> Scan(int64_t start_key, int64_t end_key) const;
 
+    // Number of pages a scan of [start_key, end_key] reads, without reading any
+    // Without an index, every page of an SST overlapping the range may be read
+    virtual size_t EstimateScanPages(int64_t start_key, int64_t end_key) const;
+
+    // End of the pages a scan up to end_key reads, readahead stops there
+    // Without an index, every page up to the end of the data may be read
+    virtual off_t ScanEndOffset(int64_t /*end_key*/) const { return DataEndOffset(); }
+
 
 protected:
+    inline static atomic<uint32_t> next_file_id_ = 1;
+
     off_t GetFileSize() const;
+
+    // Maps the file on first use in ReadMode::kMmap, returns nullptr when not reading through mmap
+    const char *EnsureMapped() const;
+
+    // Reads size bytes at offset, from the mapping if any
+    ssize_t ReadBytes(void *buffer, size_t size, off_t offset) const;
+
+    // Writes size bytes at offset, exits on failure
+    void WriteBytes(const void *buffer, size_t size, off_t offset) const;
+
+    // Same as ReadBytes and WriteBytes, through direct_fd_ in ReadMode::kDirectIO
+    // buffer, size and offset are multiples of kPageSize, see PageData
+    ssize_t ReadDirect(void *buffer, size_t size, off_t offset) const;
+    void WriteDirect(const void *buffer, size_t size, off_t offset) const;
+
+    // Returns direct_fd_, opening it if needed, the caller holds file_mutex_
+    int EnsureDirectFileOpen() const;
+
+    // Returns the page at the page aligned offset if cached by the buffer pool or the scan ring, or mapped
+    // Otherwise sets read_size to the bytes of key-value pairs to read, 0 past the last page
+    PageHandle FindPage(off_t aligned_offset, bool is_sequential_flooding, size_t &read_size) const;
+
+    // True when pages are read with direct I/O, bypassing the page cache
+    static bool IsDirectIO();
+
+    // Buffer to read the page of read_size bytes into, whole pages are read with direct I/O
+    static PageData NewPageData(size_t read_size, bool is_sequential_flooding);
+
+    // Caches the page read into data, decoded if not raw, returns an empty handle if the read failed
+    PageHandle CachePage(off_t aligned_offset, PageData data, ssize_t bytes_read, size_t read_size,
+                         bool is_sequential_flooding) const;
+
+    // Makes the bytes written so far durable, exits on failure
+    void SyncFile() const;
+
+    // Key-value pairs take [DataStartOffset(), DataEndOffset()) of the file, pages are never read past the end
+    virtual off_t DataStartOffset() const { return 0; }
+    virtual off_t DataEndOffset() const { return file_size_; }
+
     virtual void InitialKeyRange();
 
     bool ReadEntry(const char *buffer, size_t buffer_size, size_t &pos, pair<int64_t, int64_t> &entry) const;
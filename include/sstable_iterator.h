@@ -0,0 +1,54 @@
+//
+// Created by Kiiro Huang on 2024-12-05.
+//
+
+#ifndef SSTABLE_ITERATOR_H
+#define SSTABLE_ITERATOR_H
+#include <optional>
+
+#include "iterator.h"
+#include "readahead.h"
+#include "sstable.h"
+
+// Cursor over the key-value pairs of one SST, holding a single pinned page at a time
+// A scan that knows where it ends also holds the next pages, read ahead in growing windows
+class SSTableIterator : public Iterator {
+    const SSTable *sst_;
+
+    // Pages of a wide scan are not put into the buffer pool
+    bool is_sequential_flooding_;
+
+    PageHandle page_;
+    LeafPage leaf_; // pairs of page_
+    off_t offset_ = -1; // offset of the current page, -1 when not valid
+    size_t index_ = 0; // index of the current pair inside the current page
+
+    off_t advised_offset_ = -1; // start of the range advised MADV_SEQUENTIAL by the last Seek
+
+    // Reads ahead for a scan ending at a known offset, empty when every page is read one at a time
+    optional<Readahead> readahead_;
+
+public:
+    // Pages are read ahead up to readahead_end_offset, -1 reads every page one at a time
+    explicit SSTableIterator(const SSTable *sst, bool is_sequential_flooding = false,
+                             off_t readahead_end_offset = -1);
+
+    ~SSTableIterator() override;
+
+    bool Valid() const override { return offset_ >= 0; }
+
+    void Seek(int64_t key) override;
+
+    void Next() override;
+
+    int64_t Key() const override { return leaf_.Key(index_); }
+
+    int64_t Value() const override { return leaf_.Value(index_); }
+
+private:
+    // Reads the page at offset and moves to its first pair, the iterator is not valid past the last page
+    void ReadPage(off_t offset);
+};
+
+
+#endif // SSTABLE_ITERATOR_H
@@ -0,0 +1,66 @@
+//
+// Created by Kiiro Huang on 2024-12-04.
+//
+
+#ifndef TABLE_CACHE_H
+#define TABLE_CACHE_H
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "../utils/constants.h"
+#include "options.h"
+
+using namespace std;
+
+class SSTable;
+
+// Keeps the file descriptors of recently used SSTs open, up to a maximum number of open files
+// Metadata (key range, bloom filter, B-Tree index) is parsed once and stays in the SST object,
+// so a cached SST needs no syscall at all to be read
+class TableCache {
+    size_t capacity_ = kMaxOpenFiles;
+
+    ReadMode read_mode_ = ReadMode::kBufferPool;
+
+    // Most recently used SST at the front
+    list<const SSTable *> lru_;
+    unordered_map<const SSTable *, list<const SSTable *>::iterator> entries_;
+
+    // SSTs are read by foreground reads and background flushes at the same time
+    mutable mutex mutex_;
+
+    TableCache() = default;
+
+    TableCache(const TableCache &) = delete;
+    TableCache &operator=(const TableCache &) = delete;
+
+public:
+    static TableCache &GetInstance();
+
+    // Closes the least recently used files if more than max_open_files are open
+    void SetCapacity(size_t max_open_files);
+
+    // Applies to the SSTs opened from now on
+    void SetReadMode(ReadMode read_mode) { read_mode_ = read_mode; }
+
+    ReadMode GetReadMode() const { return read_mode_; }
+
+    // Marks the open file of sst as the most recently used one, the caller holds the file mutex of sst
+    void Touch(const SSTable *sst);
+
+    // Forgets sst, called when its file is closed
+    void Erase(const SSTable *sst);
+
+    size_t Size() const {
+        lock_guard lock(mutex_);
+        return entries_.size();
+    }
+
+private:
+    // Closes the least recently used files, except keep and the files other threads are using
+    void EvictToCapacity(const SSTable *keep);
+};
+
+
+#endif // TABLE_CACHE_H
@@ -0,0 +1,79 @@
+//
+// Created by Kiiro Huang on 2024-12-07.
+//
+
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "options.h"
+
+using namespace std;
+
+// Log of the writes not flushed to SSTs yet, one file per memtable, named wal_<number>.log
+// Every append is one record: the number of pairs, the pairs, and a checksum of both,
+// so a record torn by a crash is dropped as a whole on replay
+class WriteAheadLog {
+    string db_name_;
+    WalSyncMode sync_mode_;
+    chrono::milliseconds sync_interval_;
+
+    // Guards the current file, which the sync thread syncs meanwhile
+    mutex mutex_;
+    int fd_ = -1;
+    int64_t number_;
+    bool is_dirty_ = false; // appended to since the last sync
+
+    // Syncs the log every sync_interval_ in WalSyncMode::kInterval
+    thread sync_thread_;
+    condition_variable sync_cv_;
+    bool is_closing_ = false;
+
+public:
+    // Starts the log file numbered number in db_name
+    WriteAheadLog(const string &db_name, int64_t number, WalSyncMode sync_mode, size_t sync_interval_ms);
+
+    // Syncs and closes the current log file, the file stays on storage
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    // Appends one record of the pairs with a single write, synced before returning in WalSyncMode::kEveryWrite
+    void Append(const vector<pair<int64_t, int64_t>> &pairs);
+
+    // Closes the current log file and continues in the next one, returns the number of the closed file
+    // The closed file is synced unless in WalSyncMode::kNever
+    int64_t Roll();
+
+    // Numbers of the log files in db_name, in order
+    static vector<int64_t> ListLogs(const string &db_name);
+
+    // Pairs of the records of the log file, up to the first torn or corrupt record
+    static vector<pair<int64_t, int64_t>> ReadLog(const string &db_name, int64_t number);
+
+    // Removes the log file once its writes are in an SST
+    static void RemoveLog(const string &db_name, int64_t number);
+
+private:
+    static string LogPath(const string &db_name, int64_t number);
+
+    static uint64_t Checksum(const int64_t *data, size_t size);
+
+    void OpenFile();
+
+    // Syncs the current file when appended to, with mutex_ held
+    void SyncLocked();
+
+    // Body of sync_thread_
+    void SyncLoop();
+};
+
+
+#endif // WRITE_AHEAD_LOG_H
@@ -0,0 +1,31 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#ifndef WRITE_BATCH_H
+#define WRITE_BATCH_H
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Puts and deletes written to the database at once, see Database::Write
+// Later records of the same key win, as if they were written one by one
+class WriteBatch {
+    friend class Database;
+
+    // Key-value pairs in the order they were added, deletes are tombstones (INT64_MIN values)
+    vector<pair<int64_t, int64_t>> pairs_;
+
+public:
+    void Put(const int64_t key, const int64_t value) { pairs_.emplace_back(key, value); }
+
+    void Delete(const int64_t key) { pairs_.emplace_back(key, INT64_MIN); }
+
+    void Clear() { pairs_.clear(); }
+
+    size_t Count() const { return pairs_.size(); }
+};
+
+
+#endif // WRITE_BATCH_H
@@ -7,6 +7,9 @@ make
 # Run experiments
 ./kv-experiment
 
+# Run experiments reading SSTs through mmap, written to experiment_*_mmap.csv
+./kv-experiment mmap
+
 # Plot graphs
 python3 ../plot_generator.py
 
@@ -0,0 +1,266 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#include "../include/async_reader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define HAS_IO_URING
+#endif
+
+#include "../utils/constants.h"
+#include "../utils/log.h"
+
+AsyncReader &AsyncReader::GetInstance() {
+    static const unique_ptr<AsyncReader> instance(IoUringReader::IsSupported()
+                                                          ? static_cast<AsyncReader *>(new IoUringReader())
+                                                          : new ThreadPoolReader(kIoThreads));
+    return *instance;
+}
+
+#ifdef HAS_IO_URING
+namespace {
+// An io_uring set up through the raw syscalls, used by one thread only
+// The kernel reads the submission queue from sq_head_ to sq_tail_ and appends completions at cq_tail_
+class IoUring {
+    int fd_ = -1;
+    unsigned num_entries_ = 0;
+
+    void *sq_ring_ = MAP_FAILED;
+    void *cq_ring_ = MAP_FAILED;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+
+    io_uring_sqe *sqes_ = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sqes_size_ = 0;
+
+    unsigned *sq_tail_ = nullptr;
+    unsigned *sq_mask_ = nullptr;
+    unsigned *sq_array_ = nullptr;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned *cq_mask_ = nullptr;
+    io_uring_cqe *cqes_ = nullptr;
+
+public:
+    explicit IoUring(const unsigned entries) {
+        io_uring_params params{};
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) {
+            return;
+        }
+        num_entries_ = params.sq_entries;
+
+        // Newer kernels map both rings at once
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool is_single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (is_single_mmap) {
+            sq_ring_size_ = cq_ring_size_ = max(sq_ring_size_, cq_ring_size_);
+        }
+
+        sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                        IORING_OFF_SQ_RING);
+        cq_ring_ = is_single_mmap ? sq_ring_
+                                  : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                         fd_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe *>(
+                mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+        if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+            Release();
+            return;
+        }
+
+        const auto sq = static_cast<char *>(sq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+        const auto cq = static_cast<char *>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    }
+
+    ~IoUring() { Release(); }
+
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    bool IsValid() const { return fd_ >= 0; }
+
+    unsigned NumEntries() const { return num_entries_; }
+
+    // Submits at most NumEntries() reads with one syscall and waits for all of them
+    void ReadAll(const span<ReadRequest> requests) const {
+        // Only this thread moves the tail of the submission queue
+        unsigned tail = *sq_tail_;
+        for (size_t i = 0; i < requests.size(); i++) {
+            const unsigned index = tail & *sq_mask_;
+            io_uring_sqe &sqe = sqes_[index];
+            memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = requests[i].fd;
+            sqe.addr = reinterpret_cast<uint64_t>(requests[i].buffer);
+            sqe.len = static_cast<uint32_t>(requests[i].size);
+            sqe.off = requests[i].offset;
+            sqe.user_data = i;
+            sq_array_[index] = index;
+            ++tail;
+        }
+
+        // The entries are written before the kernel sees the new tail
+        atomic_ref(*sq_tail_).store(tail, memory_order_release);
+
+        size_t num_to_submit = requests.size();
+        size_t num_done = 0;
+        while (num_done < requests.size()) {
+            const long submitted = syscall(__NR_io_uring_enter, fd_, num_to_submit, requests.size() - num_done,
+                                           IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (submitted < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+                cerr << "Failed to submit reads to io_uring: " << strerror(errno) << endl;
+                exit(1);
+            }
+            num_to_submit -= submitted;
+
+            unsigned head = atomic_ref(*cq_head_).load(memory_order_relaxed);
+            const unsigned cq_tail = atomic_ref(*cq_tail_).load(memory_order_acquire);
+            for (; head != cq_tail; ++head) {
+                const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+                requests[cqe.user_data].result = cqe.res;
+                ++num_done;
+            }
+            atomic_ref(*cq_head_).store(head, memory_order_release);
+        }
+    }
+
+private:
+    void Release() {
+        if (sqes_ != MAP_FAILED) {
+            munmap(sqes_, sqes_size_);
+        }
+        if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+        if (sq_ring_ != MAP_FAILED) {
+            munmap(sq_ring_, sq_ring_size_);
+        }
+        sqes_ = static_cast<io_uring_sqe *>(MAP_FAILED);
+        sq_ring_ = cq_ring_ = MAP_FAILED;
+
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+};
+} // namespace
+#endif
+
+bool IoUringReader::IsSupported() {
+#ifdef HAS_IO_URING
+    static const bool is_supported = IoUring(1).IsValid();
+    return is_supported;
+#else
+    return false;
+#endif
+}
+
+void IoUringReader::ReadAll(span<ReadRequest> requests) {
+#ifdef HAS_IO_URING
+    thread_local const IoUring ring(kIoUringEntries);
+    if (ring.IsValid()) {
+        while (!requests.empty()) {
+            const size_t num_requests = min(requests.size(), static_cast<size_t>(ring.NumEntries()));
+            ring.ReadAll(requests.first(num_requests));
+            requests = requests.subspan(num_requests);
+        }
+        return;
+    }
+    LOG("  Could not set up io_uring, reading " << requests.size() << " pages one at a time");
+#endif
+
+    for (ReadRequest &request: requests) {
+        request.result = pread(request.fd, request.buffer, request.size, request.offset);
+        if (request.result < 0) {
+            request.result = -errno;
+        }
+    }
+}
+
+ThreadPoolReader::ThreadPoolReader(const size_t num_threads) {
+    for (size_t i = 0; i < max(static_cast<size_t>(1), num_threads); i++) {
+        threads_.emplace_back(&ThreadPoolReader::ReadLoop, this);
+    }
+}
+
+ThreadPoolReader::~ThreadPoolReader() {
+    {
+        lock_guard lock(mutex_);
+        is_stopping_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &t: threads_) {
+        t.join();
+    }
+}
+
+void ThreadPoolReader::ReadAll(const span<ReadRequest> requests) {
+    if (requests.empty()) {
+        return;
+    }
+
+    Batch batch;
+    batch.num_pending = requests.size();
+    {
+        lock_guard lock(mutex_);
+        for (ReadRequest &request: requests) {
+            queue_.emplace_back(&request, &batch);
+        }
+    }
+    cv_.notify_all();
+
+    unique_lock lock(batch.mutex_);
+    batch.cv_.wait(lock, [&batch] { return batch.num_pending == 0; });
+}
+
+void ThreadPoolReader::ReadLoop() {
+    while (true) {
+        unique_lock lock(mutex_);
+        cv_.wait(lock, [this] { return is_stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            return;
+        }
+        const auto [request, batch] = queue_.front();
+        queue_.pop_front();
+        lock.unlock();
+
+        request->result = pread(request->fd, request->buffer, request->size, request->offset);
+        if (request->result < 0) {
+            request->result = -errno;
+        }
+
+        // Notified under the lock, the batch lives on the stack of the waiting thread
+        lock_guard batch_lock(batch->mutex_);
+        if (--batch->num_pending == 0) {
+            batch->cv_.notify_one();
+        }
+    }
+}
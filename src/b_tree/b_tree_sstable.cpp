@@ -4,15 +4,22 @@
 
 #include "../../include/b_tree/b_tree_sstable.h"
 
+#include <algorithm>
+#include <filesystem>
 #include <regex>
-#include <sys/_types/_off_t.h>
 #include <sys/fcntl.h>
+#include <sys/types.h>
 #include <unistd.h>
 
+#include "../../include/b_tree/b_tree_sstable_builder.h"
+#include "../../include/bit_packed_leaf.h"
+#include "../../include/leaf_page.h"
 #include "../../include/buffer_pool/buffer_pool_manager.h"
 #include "../../include/buffer_pool/page.h"
 #include "../../include/memtable.h"
+#include "../../include/readahead.h"
 #include "../../include/sst_counter.h"
+#include "../../include/table_cache.h"
 #include "../../utils/constants.h"
 #include "../../utils/log.h"
 
@@ -21,147 +28,140 @@ namespace fs = std::filesystem;
 BTreeSSTable::BTreeSSTable(const string &db_name, const bool create_new, const int64_t level) : SSTable() {
     if (create_new) {
         // If creation, generate a new file name
-        const string new_file_name = SSTCounter::GetInstance().GenerateFileName(level);
-        file_path_ = fs::path(db_name) / new_file_name;
-
-        fd_ = open(file_path_.c_str(), O_RDWR | O_CREAT, 0644);
-        if (fd_ < 0) {
-            throw std::runtime_error("Failed to open SSTable file: " + file_path_);
-        }
+        run_ = SSTCounter::GetInstance().GenerateIndex(level);
+        CreateFile(db_name, SSTCounter::FileName(level, run_));
     } else {
         // If not creation, use the given file name
         file_path_ = fs::path(db_name);
 
-        fd_ = open(file_path_.c_str(), O_RDWR | O_CREAT, 0644);
-        if (fd_ < 0) {
-            throw std::runtime_error("Failed to open SSTable file: " + file_path_);
-        }
-
         LOG("  Open file: " << file_path_);
 
         file_size_ = GetFileSize();
         BTreeSSTable::InitialKeyRange();
+        LoadIndex();
     }
 }
 
-void BTreeSSTable::InitialKeyRange() {
-    char buffer[kPageSize];
-
-    const size_t page_num_reserve_btree = ReadOffset();
-    const off_t offset = page_num_reserve_btree * kPageSize;
-    // Read the first block to get the minimum key
-    ssize_t bytes_read = pread(fd_, buffer, kPageSize, offset);
-    if (bytes_read > 0) {
-        size_t pos = 0;
-        pair<int64_t, int64_t> first_entry;
-        if (ReadEntry(buffer, bytes_read, pos, first_entry)) {
-            min_key_ = first_entry.first;
-        }
-    }
-
-    // Read the last block to get the maximum key
-    const off_t last_block_offset = file_size_ > offset ? file_size_ - kPageSize : offset;
-    bytes_read = pread(fd_, buffer, kPageSize, last_block_offset);
-    if (bytes_read > 0) {
-        size_t pos = 0;
-        pair<int64_t, int64_t> last_entry;
-        while (pos < static_cast<size_t>(bytes_read) && ReadEntry(buffer, bytes_read, pos, last_entry)) {
-            // Keep reading to get the last entry in the block
-        }
-        max_key_ = last_entry.first;
-    }
+BTreeSSTable::BTreeSSTable(const string &db_name, const int64_t level, const int64_t run, const optional<size_t> part) :
+    SSTable() {
+    run_ = run;
+    CreateFile(db_name, SSTCounter::FileName(level, run, part));
 }
 
+void BTreeSSTable::CreateFile(const string &db_name, const string &file_name) {
+    file_path_ = fs::path(db_name) / file_name;
 
-void BTreeSSTable::WritePage(const off_t offset, const Page *page, const bool is_final_page = false) const {
-    fd_ = EnsureFileOpen();
-
-    LOG("  └Writing page " << page->id_);
-
-    // Write the page to the file
-    const auto data = page->data_;
-
-    int64_t buffer[min(kPagePairs * 2, data.size())];
-    memset(buffer, 0, sizeof(buffer));
+    lock_guard lock(file_mutex_);
+    fd_ = open(file_path_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open SSTable file: " + file_path_);
+    }
+    EnsureFileOpen();
+}
 
-    // Change data to buffer
-    for (size_t i = 0; i < data.size(); ++i) {
-        buffer[i] = data[i];
+void BTreeSSTable::InitialKeyRange() {
+    if (file_size_ < static_cast<off_t>(kFooterSize)) {
+        cerr << "SSTable file is too small to have a footer: " << file_path_ << endl;
+        exit(1);
     }
 
-    const ssize_t bytes_written = pwrite(fd_, &buffer, sizeof(buffer), offset);
-    if (bytes_written < 0) {
-        cerr << "Failed to write page at offset " << offset << endl;
+    // Read the footer at the end of the file
+    int64_t footer[kFooterSize / sizeof(int64_t)];
+    const ssize_t bytes_read = ReadBytes(footer, kFooterSize, file_size_ - kFooterSize);
+    if (bytes_read != kFooterSize || footer[0] != kFooterMagic) {
+        cerr << "Invalid footer in SSTable file: " << file_path_ << endl;
         exit(1);
     }
 
-    // Write the page to the buffer pool
-    const auto buffer_pool = BufferPoolManager::GetInstance();
-    buffer_pool->Put(page->id_, data);
+    leaf_start_offset_ = footer[1];
+    leaf_end_offset_ = footer[2];
+    const off_t bloom_offset = footer[3];
+    const size_t bloom_num_words = footer[4];
+    const size_t bloom_num_hashes = footer[5];
+    min_key_ = footer[6];
+    max_key_ = footer[7];
+    num_pairs_ = footer[8];
+    leaf_format_ = static_cast<LeafFormat>(footer[9]);
+
+    // Keep the bloom filter resident in memory
+    vector<uint64_t> bits(bloom_num_words);
+    if (bloom_num_words > 0) {
+        const size_t bloom_size = bloom_num_words * sizeof(uint64_t);
+        if (ReadBytes(bits.data(), bloom_size, bloom_offset) != static_cast<ssize_t>(bloom_size)) {
+            cerr << "Failed to read bloom filter of SSTable file: " << file_path_ << endl;
+            exit(1);
+        }
+    }
+    bloom_filter_ = BloomFilter(std::move(bits), bloom_num_hashes);
 }
 
+void BTreeSSTable::WriteFooter(const off_t offset) const {
+    // Bloom filter starts at a new page right after the leaf pages
+    const off_t bloom_offset = offset;
+    const size_t bloom_size = bloom_filter_.SizeInBytes();
+    if (bloom_size > 0) {
+        WriteBytes(bloom_filter_.bits_.data(), bloom_size, bloom_offset);
+    }
+    LOG("  └Writing bloom filter of " << bloom_size << " bytes");
+
+    const int64_t footer[kFooterSize / sizeof(int64_t)] = {
+            kFooterMagic,
+            leaf_start_offset_,
+            leaf_end_offset_,
+            bloom_offset,
+            static_cast<int64_t>(bloom_filter_.bits_.size()),
+            static_cast<int64_t>(bloom_filter_.num_hashes_),
+            min_key_,
+            max_key_,
+            static_cast<int64_t>(num_pairs_),
+            static_cast<int64_t>(leaf_format_),
+    };
+    WriteBytes(footer, kFooterSize, bloom_offset + bloom_size);
+}
 
-string BTreeSSTable::FlushToStorage(const vector<int64_t> *data) {
-    const size_t start_pos = file_path_.find('/') + 1;
-    const size_t end_pos = file_path_.rfind(".bin");
-    const string sst_name = file_path_.substr(start_pos, end_pos - start_pos);
-
-    vector<int64_t> prev_layer_nodes;
-
-    const size_t num_leaves = data->size() / (2 * kPagePairs);
-    const size_t num_internal_nodes = max(static_cast<size_t>(1), num_leaves / kFanOut);
-
-    // 1 page for root
-    // 1 page for every 2nd layer node
-    const size_t num_pages = 1 + num_internal_nodes;
-
-    // Offset are left for the first 2 layers of the B-Tree
-    const off_t start_offset = num_pages * kPageSize;
-    off_t offset = start_offset;
-
-    // Write the data to B-Tree leaf nodes
-    while (offset < start_offset + data->size() * kPairSize / 2) {
-        vector<int64_t> page_data;
-        page_data.clear();
 
-        string page_id = sst_name + "_" + to_string(offset);
-        for (size_t j = (offset - start_offset) * 2 / kPairSize;
-             j < (offset - start_offset) * 2 / kPairSize + kPagePairs * 2 && j < data->size(); j++) {
-            page_data.push_back((*data)[j]);
-        }
-        LOG("  ┌-Current page size: " << page_data.size());
-        const auto page = new Page(page_id, page_data);
-
-        // Fetch the last key of every page
-        if (!page_data.empty()) {
-            const int64_t last_key = page_data[page_data.size() - 2];
-            LOG("  | Last key: " << last_key);
-            prev_layer_nodes.push_back(last_key);
-        }
+size_t BTreeSSTable::WritePage(const off_t offset, Page page, const bool should_cache) const {
+    LOG("  └Writing page " << page.id_);
 
-        WritePage(offset, page);
-
-        offset += kPageSize;
+    // Leaves are written in the format of the SST, index pages are always raw
+    // Leaves of any other format than raw are cached columnar, bit-packed ones encode the columnar page
+    const bool is_leaf = offset >= leaf_start_offset_;
+    if (is_leaf && leaf_format_ != LeafFormat::kRaw) {
+        page.data_ = LeafPage::ToColumnar(page.data_);
     }
+    const bool is_bit_packed = is_leaf && leaf_format_ == LeafFormat::kBitPacked;
+    PageData encoded = is_bit_packed ? BitPackedLeaf::Encode(page.data_) : PageData();
+    PageData &data = is_bit_packed ? encoded : page.data_;
 
-    // Generate first 2 layers nodes
-    GenerateBTreeLayers(prev_layer_nodes);
-
-    // Root node writes to the first page
-    WritePage(0, new Page(sst_name + "_0", root_));
+    // Write the page to the file
+    const size_t size = min(kPagePairs * 2, data.size()) * sizeof(int64_t);
+    const ReadMode read_mode = TableCache::GetInstance().GetReadMode();
+    if (read_mode == ReadMode::kDirectIO) {
+        // Direct I/O writes whole pages, a partial page is padded with zeros for the write
+        const size_t data_size = data.size();
+        data.resize(kPagePairs * 2);
+        WriteDirect(data.data(), kPageSize, offset);
+        data.resize(data_size);
+    } else {
+        WriteBytes(data.data(), size, offset);
+    }
 
-    // Every second layer node writes to a new page
-    for (size_t i = 0; i < internal_nodes_.size(); i++) {
-        WritePage(kPageSize * (i + 1), new Page(sst_name + "_" + to_string(kPageSize * (i + 1)), internal_nodes_[i]));
+    // Hand the page data over to the buffer pool, unless pages are read through mmap
+    if (should_cache && read_mode != ReadMode::kMmap) {
+        const auto buffer_pool = BufferPoolManager::GetInstance();
+        buffer_pool->Put(page.id_, std::move(page.data_));
     }
+    return size;
+}
 
-    LOG(" └Flushed to SST: " << file_path_);
 
-    file_size_ = GetFileSize();
-    min_key_ = (*data)[0];
-    max_key_ = (*data)[data->size() - 2];
+string BTreeSSTable::FlushToStorage(const vector<int64_t> *data, const LeafFormat leaf_format) {
+    BTreeSSTableBuilder builder(this, data->size() / 2, true, leaf_format);
+    for (size_t i = 0; i < data->size(); i += 2) {
+        builder.Add((*data)[i], (*data)[i + 1]);
+    }
 
-    return file_path_;
+    return builder.Finish();
 }
 
 void BTreeSSTable::GenerateBTreeLayers(vector<int64_t> prev_layer_nodes) {
@@ -169,264 +169,201 @@ void BTreeSSTable::GenerateBTreeLayers(vector<int64_t> prev_layer_nodes) {
     root_.clear();
 
     // Build internal nodes from leaf nodes (prev_layer_nodes)
-    vector<vector<int64_t>> new_layer_nodes;
     size_t index = 0;
-    size_t num_keys = prev_layer_nodes.size();
+    const size_t num_keys = prev_layer_nodes.size();
 
     // Create internal nodes with up to kFanOut keys
     while (index < num_keys) {
-        size_t keys_in_node = std::min(kFanOut, num_keys - index);
-        vector<int64_t> internal_node;
+        const size_t keys_in_node = std::min(kFanOut, num_keys - index);
+        vector<int64_t> internal_node(prev_layer_nodes.begin() + index,
+                                      prev_layer_nodes.begin() + index + keys_in_node);
 
-        for (size_t i = 0; i < keys_in_node; ++i) {
-            internal_node.push_back(prev_layer_nodes[index + i]);
-        }
+        // Use the last key of each internal node as the separator key in root
+        root_.push_back(internal_node.back());
 
-        internal_nodes_.push_back(internal_node);
-        new_layer_nodes.push_back(internal_node);
+        internal_nodes_.push_back(std::move(internal_node));
         index += keys_in_node;
     }
 
-    // Now build the root node from internal nodes
-    vector<int64_t> root_node_keys;
-    for (const auto &node: new_layer_nodes) {
-        // Use the last key of each internal node as the separator key
-        root_node_keys.push_back(node.back());
-    }
-
-    // If root node has more keys than allowed, split it
-    if (root_node_keys.size() > kFanOut) {
-        // We need to create a new root node layer
-        vector<vector<int64_t>> root_layer_nodes;
-        index = 0;
-        size_t num_root_keys = root_node_keys.size();
-
-        while (index < num_root_keys) {
-            size_t keys_in_node = std::min(kFanOut, num_root_keys - index);
-            vector<int64_t> root_node;
-
-            for (size_t i = 0; i < keys_in_node; ++i) {
-                root_node.push_back(root_node_keys[index + i]);
-            }
-
-            root_layer_nodes.push_back(root_node);
-            index += keys_in_node;
-        }
-
-        // Since we only have three layers, the root must be a single node
-        // So we need to merge the root_layer_nodes into a single root node
-        // and move the previous root_layer_nodes to internal_nodes_
-        if (root_layer_nodes.size() == 1) {
-            // The root node fits in one node
-            root_ = root_layer_nodes[0];
-        } else {
-            // We need to create a new root node with the last keys of root_layer_nodes
-            vector<int64_t> new_root_node;
-            for (const auto &node: root_layer_nodes) {
-                new_root_node.push_back(node.back());
-            }
-
-            // The root node must fit in one node
-            if (new_root_node.size() > kFanOut) {
-                cerr << "Error: Root node exceeds maximum capacity of " << kFanOut << " keys." << endl;
-                exit(1);
-            }
-
-            root_ = new_root_node;
+    // Root node is kept whole in memory, on storage it takes as many pages as it needs
+    // so the SST never needs a 4th layer
+}
 
-            // Move the previous root_layer_nodes to internal_nodes_
-            internal_nodes_.clear();
-            for (const auto &node: root_layer_nodes) {
-                internal_nodes_.push_back(node);
-            }
-        }
-    } else {
-        // Root node fits in one node
-        root_ = root_node_keys;
-    }
+size_t BTreeSSTable::NumRootPages(const size_t num_internal_nodes) {
+    return max(static_cast<size_t>(1), (num_internal_nodes + kFanOut - 1) / kFanOut);
 }
 
-off_t BTreeSSTable::ReadOffset() const {
-    // Read first page of the BTreeSSTable, get the number of second layer nodes
-    const Page *page = GetPage(0);
-    if (!page) {
-        cerr << "Failed to read page 0 for ReadOffset: " << file_path_ << endl;
+void BTreeSSTable::LoadIndex() {
+    // Number of nodes in every layer follows from the number of leaf pages
+    const size_t num_leaves = (leaf_end_offset_ - leaf_start_offset_ + kPageSize - 1) / kPageSize;
+    const size_t num_internal_nodes = (num_leaves + kFanOut - 1) / kFanOut;
+    const size_t num_root_pages = NumRootPages(num_internal_nodes);
+
+    // Read root and internal pages at once, they stay in memory as long as the SST is open
+    vector<int64_t> index_pages(leaf_start_offset_ / sizeof(int64_t));
+    const ssize_t bytes_read = ReadBytes(index_pages.data(), leaf_start_offset_, 0);
+    if (bytes_read != leaf_start_offset_) {
+        cerr << "Failed to read B-Tree index of SSTable file: " << file_path_ << endl;
         exit(1);
     }
 
-    const auto data = page->data_;
-    for (auto i = 0; i < data.size(); i++) {
-        if (data[i] == 0) {
-            return 1 + i;
-        }
+    root_.clear();
+    internal_nodes_.clear();
+
+    // Page i of the internal layer holds the last key of leaves [i * kFanOut, (i + 1) * kFanOut)
+    for (size_t i = 0; i < num_internal_nodes; i++) {
+        const size_t keys_in_node = min(kFanOut, num_leaves - i * kFanOut);
+        const auto first = index_pages.begin() + (num_root_pages + i) * kPageSize / sizeof(int64_t);
+        internal_nodes_.emplace_back(first, first + keys_in_node);
     }
 
-    return 1 + data.size();
+    // Root page j holds the last key of internal nodes [j * kFanOut, (j + 1) * kFanOut)
+    for (size_t i = 0; i < num_internal_nodes; i++) {
+        root_.push_back(index_pages[i / kFanOut * kPageSize / sizeof(int64_t) + i % kFanOut]);
+    }
 }
 
-optional<int64_t> BTreeSSTable::BinarySearch(const int64_t key) const {
-    const size_t num_pages = (file_size_ + kPageSize - 1) / kPageSize;
-
-    fd_ = open(file_path_.c_str(), O_RDWR | O_CREAT, 0644);
-    const size_t page_num_reserve_btree = ReadOffset();
-    size_t left = page_num_reserve_btree;
-    size_t right = num_pages - 1;
+optional<size_t> BTreeSSTable::FindLeaf(const int64_t key) const {
+    // Separators are the last key of every child, the first one not less than key leads to it
+    const auto root_it = ranges::lower_bound(root_, key);
+    if (root_it == root_.end()) {
+        // The key is greater than all keys in the SSTable
+        return nullopt;
+    }
 
-    while (left <= right) {
-        const size_t mid = left + (right - left) / 2;
-        const off_t offset = mid * kPageSize;
+    const size_t node_index = root_it - root_.begin();
+    const auto &internal_node = internal_nodes_[node_index];
+    const auto internal_it = ranges::lower_bound(internal_node, key);
 
-        const Page *page = GetPage(offset);
-        const auto data = page->data_;
-        const size_t num_pairs = page->GetSize() / 2;
+    return node_index * kFanOut + (internal_it - internal_node.begin());
+}
 
-        const int64_t first_key = data[0];
-        const int64_t last_key = data[(num_pairs - 1) * 2];
+vector<optional<int64_t>> BTreeSSTable::MultiGet(const vector<int64_t> &keys) const {
+    vector<optional<int64_t>> values(keys.size());
 
-        if (key == first_key) {
-            LOG("\t\tFound key " << key << " in " << file_path_);
-            return data[1];
-        }
-        if (key == last_key) {
-            LOG("\t\tFound key " << key << " in " << file_path_);
-            return data[num_pairs * 2 - 1];
+    size_t i = 0;
+    while (i < keys.size()) {
+        // This key and the ones after it are greater than all keys in the SSTable
+        const auto leaf_index = FindLeaf(keys[i]);
+        if (!leaf_index.has_value()) {
+            break;
         }
 
-        if (key > first_key && key < last_key) {
-            // Since the key is already in order, do another binary search to search inside the page
-            size_t page_left = 0;
-            size_t page_right = num_pairs - 1;
-
-            while (page_left <= page_right) {
-                const size_t page_mid = page_left + (page_right - page_left) / 2;
-                const int64_t mid_key = data[page_mid * 2];
-
-                if (mid_key == key) {
-                    LOG("\t\tFound key " << key << " in " << file_path_);
-                    return data[page_mid * 2 + 1];
-                }
-
-                if (mid_key < key) {
-                    page_left = page_mid + 1;
-                } else {
-                    page_right = page_mid - 1;
-                }
-            }
-
-            return nullopt;
+        const PageHandle page = GetPage(leaf_start_offset_ + leaf_index.value() * kPageSize);
+        if (!page) {
+            break;
         }
 
-        if (key < first_key) {
-            right = mid - 1;
-        } else {
-            left = mid + 1;
+        // Every key up to the last key of the leaf can only be in this leaf
+        const int64_t last_key = internal_nodes_[leaf_index.value() / kFanOut][leaf_index.value() % kFanOut];
+        const LeafPage leaf = AsLeaf(page);
+        const size_t num_pairs = leaf.NumPairs();
+
+        // Keys are sorted, the search for the next key starts where the last one ended
+        size_t page_left = 0;
+        for (; i < keys.size() && keys[i] <= last_key; ++i) {
+            page_left = leaf.LowerBound(keys[i], page_left);
+            if (page_left < num_pairs && leaf.Key(page_left) == keys[i]) {
+                values[i] = leaf.Value(page_left);
+            }
         }
     }
 
-    LOG("  Could not find key " << key << " in " << file_path_);
-    return nullopt;
+    return values;
 }
 
-int64_t BTreeSSTable::BinarySearchUpperbound(const int64_t key, bool is_sequential_flooding) const {
-    const size_t num_pages = (file_size_ + kPageSize - 1) / kPageSize;
+size_t BTreeSSTable::EstimateScanPages(const int64_t start_key, const int64_t end_key) const {
+    if (max_key_ < start_key || min_key_ > end_key) {
+        return 0;
+    }
 
-    const size_t page_num_reserve_btree = ReadOffset();
-    size_t left = page_num_reserve_btree;
-    size_t right = num_pages;
+    // The separators of the leaves bound the range, the end key may be past the last leaf
+    const size_t num_leaves = (leaf_end_offset_ - leaf_start_offset_ + kPageSize - 1) / kPageSize;
+    const size_t first_leaf = FindLeaf(start_key).value_or(num_leaves);
+    const size_t last_leaf = FindLeaf(end_key).value_or(num_leaves - 1);
 
-    // Outer binary search to find the first page where first_key > key
-    while (left < right) {
-        const size_t mid = left + (right - left) / 2;
-        const off_t offset = mid * kPageSize;
+    return first_leaf <= last_leaf ? last_leaf - first_leaf + 1 : 0;
+}
 
-        const Page *page = GetPage(offset, is_sequential_flooding);
-        const auto data = page->data_;
+off_t BTreeSSTable::ScanEndOffset(const int64_t end_key) const {
+    // The end key may be past the last leaf
+    const auto leaf_index = FindLeaf(end_key);
+    if (!leaf_index.has_value()) {
+        return leaf_end_offset_;
+    }
+    return min(leaf_end_offset_, static_cast<off_t>(leaf_start_offset_ + (leaf_index.value() + 1) * kPageSize));
+}
 
-        const int64_t first_key = data[0];
+off_t BTreeSSTable::ReadOffset() const {
+    // Number of pages reserved for root and internal nodes before the first leaf
+    return leaf_start_offset_ / kPageSize;
+}
 
-        if (first_key <= key) {
-            left = mid + 1;
-        } else {
-            right = mid;
-        }
+optional<int64_t> BTreeSSTable::BinarySearch(const int64_t key) const {
+    // Root and internal nodes are in memory, descend to the only leaf that may contain the key
+    const auto leaf_index = FindLeaf(key);
+    if (!leaf_index.has_value()) {
+        LOG("  Could not find key " << key << " in " << file_path_);
+        return nullopt;
     }
 
-    if (left - 1 == num_pages) {
-        // The key is greater than or equal to all keys in the SSTable
-        return -1;
+    const PageHandle page = GetPage(leaf_start_offset_ + leaf_index.value() * kPageSize);
+    if (!page) {
+        return nullopt;
     }
 
-    // Read the page where the upper bound could be
-    const size_t page_index = left - 1;
-    const off_t page_offset = page_index * kPageSize;
-
-    const Page *page = GetPage(page_offset, is_sequential_flooding);
-    const auto data = page->data_;
-    const size_t num_pairs = page->GetSize() / 2;
-
-    const int64_t first_key = data[0];
-    const int64_t last_key = data[(num_pairs - 1) * 2];
-
-    // Inner binary search to find the upper bound within the page
-    size_t page_left = 0;
-    size_t page_right = num_pairs;
-
-    while (page_left < page_right) {
-        const size_t page_mid = page_left + (page_right - page_left) / 2;
-        const int64_t mid_key = data[page_mid * 2];
-
-        if (mid_key <= key) {
-            page_left = page_mid + 1;
-        } else {
-            page_right = page_mid;
-        }
+    // Since the key is already in order, search inside the page
+    if (const auto value = AsLeaf(page).Find(key)) {
+        LOG("\t\tFound key " << key << " in " << file_path_);
+        return value;
     }
 
-    if (page_left - 1 == num_pairs) {
-        // All keys in this page are less than or equal to the given key
-        // Check if there is a next page
-        if (page_index + 1 <= num_pages) {
-            if (page_index + 1 < num_pages) {
-                const off_t next_page_offset = (page_index + 1) * kPageSize;
-                return next_page_offset; // Upper bound starts at the next page
-            }
-            // No more keys available
-            return -1;
-        }
-        // No next page; the given key is greater than all keys
+    LOG("  Could not find key " << key << " in " << file_path_);
+    return nullopt;
+}
+
+int64_t BTreeSSTable::BinarySearchUpperbound(const int64_t key, bool /*is_sequential_flooding*/) const {
+    // The leaf found by the index holds the first key not less than the given key, no page is read
+    const auto leaf_index = FindLeaf(key);
+    if (!leaf_index.has_value()) {
+        // The key is greater than all keys in the SSTable
         return -1;
     }
 
-    // Upper bound found within the page
-    const off_t key_offset = page_offset + (page_left - 1) * kPairSize;
-    return key_offset;
+    return leaf_start_offset_ + leaf_index.value() * kPageSize;
 }
 
 vector<pair<int64_t, int64_t>> BTreeSSTable::LinearSearchToEndKey(off_t start_offset, int64_t start_key,
                                                                   int64_t end_key, bool is_sequential_flooding) const {
     vector<pair<int64_t, int64_t>> result;
 
+    // No key in the SSTable is greater than or equal to start key
+    if (start_offset < 0) {
+        return result;
+    }
+
     auto current_offset = start_offset;
 
+    // Leaves are read in order, in windows growing up to the leaf holding end key
+    Readahead readahead(this, is_sequential_flooding, ScanEndOffset(end_key));
+
     while (true) {
-        const Page *page = GetPage(current_offset, is_sequential_flooding);
+        const PageHandle page = readahead.GetPage(current_offset);
 
-        // When start key is the last key in the SSTable, next page will be nullptr
-        if (page == nullptr) {
+        // When start key is the last key in the SSTable, there is no next page
+        if (!page) {
             return result;
         }
 
-        const auto data = page->data_;
-        const size_t num_pairs = page->GetSize() / 2;
-
-        for (size_t i = 0; i < num_pairs; i++) {
-            if (data[i * 2] > end_key) {
-                return result;
-            }
-
-            if (data[i * 2] >= start_key) {
-                result.emplace_back(data[i * 2], data[i * 2 + 1]);
-            }
+        // Pairs from start key up to end key, found by searching the keys rather than comparing every one
+        const LeafPage leaf = AsLeaf(page);
+        const size_t begin = leaf.LowerBound(start_key);
+        const size_t end = leaf.UpperBound(end_key);
+        for (size_t i = begin; i < end; i++) {
+            result.emplace_back(leaf.Key(i), leaf.Value(i));
+        }
+        if (end < leaf.NumPairs()) {
+            return result;
         }
 
         current_offset += kPageSize;
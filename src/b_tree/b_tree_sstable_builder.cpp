@@ -0,0 +1,113 @@
+//
+// Created by Kiiro Huang on 2024-12-07.
+//
+
+#include "../../include/b_tree/b_tree_sstable_builder.h"
+
+#include "../../utils/constants.h"
+#include "../../utils/log.h"
+
+BTreeSSTableBuilder::BTreeSSTableBuilder(BTreeSSTable *sst, const size_t max_pairs, const bool should_cache_pages,
+                                         const LeafFormat leaf_format) :
+    sst_(sst), max_pairs_(max_pairs), should_cache_pages_(should_cache_pages), leaf_format_(leaf_format) {
+    // Leaves start after the pages the index of max_pairs pairs would take
+    // Fewer pairs leave some of these pages unused, which costs at most 1 page per 256 leaves
+    const size_t min_leaf_pairs = leaf_format == LeafFormat::kBitPacked ? kMinBitPackedLeafPairs : kPagePairs;
+    const size_t max_leaves = (max_pairs + min_leaf_pairs - 1) / min_leaf_pairs;
+    const size_t max_internal_nodes = max(static_cast<size_t>(1), (max_leaves + kFanOut - 1) / kFanOut);
+    offset_ = (BTreeSSTable::NumRootPages(max_internal_nodes) + max_internal_nodes) * kPageSize;
+
+    sst_->leaf_start_offset_ = offset_;
+    sst_->leaf_format_ = leaf_format;
+    leaf_end_offset_ = offset_;
+    sst_->min_key_ = INT64_MAX;
+    sst_->max_key_ = INT64_MIN;
+
+    // Every key, tombstones included, goes into the bloom filter
+    sst_->bloom_filter_ = BloomFilter(max_pairs);
+
+    page_data_.reserve(kPagePairs * 2);
+}
+
+void BTreeSSTableBuilder::Add(const int64_t key, const int64_t value) {
+    if (num_pairs_ == max_pairs_) {
+        throw runtime_error("Too many pairs added to SSTable file: " + sst_->file_path_);
+    }
+    ++num_pairs_;
+
+    sst_->min_key_ = min(sst_->min_key_, key);
+    sst_->max_key_ = key;
+    sst_->bloom_filter_.Put(key);
+
+    if (leaf_format_ == LeafFormat::kBitPacked) {
+        if (!bit_packed_leaf_.Fits(key, value)) {
+            FlushPage();
+        }
+        bit_packed_leaf_.Add(key, value);
+    }
+
+    page_data_.push_back(key);
+    page_data_.push_back(value);
+    if (leaf_format_ != LeafFormat::kBitPacked && page_data_.size() == kPagePairs * 2) {
+        FlushPage();
+    }
+}
+
+void BTreeSSTableBuilder::FlushPage() {
+    LOG("  ┌-Current page size: " << page_data_.size());
+
+    // Fetch the last key of every page
+    const int64_t last_key = page_data_[page_data_.size() - 2];
+    LOG("  | Last key: " << last_key);
+    last_keys_.push_back(last_key);
+
+    leaf_end_offset_ = offset_ + static_cast<off_t>(
+            sst_->WritePage(offset_, Page(sst_->GetPageId(offset_), std::move(page_data_)), should_cache_pages_));
+    offset_ += kPageSize;
+
+    page_data_ = PageData();
+    page_data_.reserve(kPagePairs * 2);
+    bit_packed_leaf_.Clear();
+}
+
+string BTreeSSTableBuilder::Finish() {
+    if (!page_data_.empty()) {
+        FlushPage();
+    }
+
+    // Generate first 2 layers nodes
+    sst_->GenerateBTreeLayers(std::move(last_keys_));
+
+    // Root node writes to the first pages, kFanOut keys per page
+    const auto &root = sst_->root_;
+    const size_t num_root_pages = BTreeSSTable::NumRootPages(sst_->internal_nodes_.size());
+    for (size_t i = 0; i < num_root_pages; i++) {
+        const auto first = root.begin() + min(i * kFanOut, root.size());
+        const auto last = root.begin() + min((i + 1) * kFanOut, root.size());
+        sst_->WritePage(kPageSize * i, Page(sst_->GetPageId(kPageSize * i), PageData(first, last)),
+                        should_cache_pages_);
+    }
+
+    // Every second layer node writes to a new page
+    for (size_t i = 0; i < sst_->internal_nodes_.size(); i++) {
+        const off_t internal_offset = kPageSize * (num_root_pages + i);
+        const auto &node = sst_->internal_nodes_[i];
+        sst_->WritePage(internal_offset, Page(sst_->GetPageId(internal_offset), PageData(node.begin(), node.end())),
+                        should_cache_pages_);
+    }
+
+    sst_->leaf_end_offset_ = leaf_end_offset_;
+    sst_->num_pairs_ = num_pairs_;
+
+    // Leaf pages are followed by the bloom filter and the footer
+    sst_->WriteFooter(offset_);
+
+    // The SST is durable before the logs or SSTs it replaces are removed
+    sst_->SyncFile();
+
+    LOG(" └Flushed to SST: " << sst_->file_path_);
+
+    sst_->file_size_ = sst_->GetFileSize();
+
+    return sst_->file_path_;
+}
@@ -0,0 +1,182 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#include "../include/bit_packed_leaf.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "../utils/constants.h"
+
+namespace {
+constexpr size_t kHeaderWords = 3;
+
+size_t NumWords(const size_t num_values, const unsigned bits) { return (num_values * bits + 63) / 64; }
+
+uint64_t Mask(const unsigned bits) { return bits == 64 ? ~0ULL : (1ULL << bits) - 1; }
+
+// Gap between two increasing keys minus 1, and value above the min value, in the unsigned range
+uint64_t KeyGap(const int64_t prev_key, const int64_t key) {
+    return static_cast<uint64_t>(key) - static_cast<uint64_t>(prev_key) - 1;
+}
+
+uint64_t ValueOffset(const int64_t min_value, const int64_t value) {
+    return static_cast<uint64_t>(value) - static_cast<uint64_t>(min_value);
+}
+
+// Appends value to the bit stream at words, bit is the number of bits written so far
+void Pack(int64_t *words, const size_t bit, const uint64_t value, const unsigned bits) {
+    if (bits == 0) {
+        return;
+    }
+    const size_t word = bit / 64;
+    const unsigned shift = bit % 64;
+    words[word] = static_cast<int64_t>(static_cast<uint64_t>(words[word]) | value << shift);
+    if (shift + bits > 64) {
+        words[word + 1] = static_cast<int64_t>(value >> (64 - shift));
+    }
+}
+
+// Reads num_values values of bits each from the bit stream at words
+// Widths of whole bytes are copied straight, which the compiler vectorizes
+void Unpack(const int64_t *words, const size_t num_values, const unsigned bits, uint64_t *values) {
+    switch (bits) {
+        case 0:
+            fill_n(values, num_values, 0);
+            return;
+        case 8:
+        case 16:
+        case 32:
+        case 64: {
+            const auto bytes = reinterpret_cast<const uint8_t *>(words);
+            const size_t value_bytes = bits / 8;
+            for (size_t i = 0; i < num_values; i++) {
+                uint64_t value = 0;
+                memcpy(&value, bytes + i * value_bytes, value_bytes);
+                values[i] = value;
+            }
+            return;
+        }
+        default:
+            break;
+    }
+
+    const uint64_t mask = Mask(bits);
+    for (size_t i = 0; i < num_values; i++) {
+        const size_t bit = i * bits;
+        const size_t word = bit / 64;
+        const unsigned shift = bit % 64;
+        uint64_t value = static_cast<uint64_t>(words[word]) >> shift;
+        if (shift + bits > 64) {
+            value |= static_cast<uint64_t>(words[word + 1]) << (64 - shift);
+        }
+        values[i] = value & mask;
+    }
+}
+} // namespace
+
+bool BitPackedLeaf::Fits(const int64_t key, const int64_t value) const {
+    if (num_pairs_ == 0) {
+        return true;
+    }
+    if (num_pairs_ == kMaxBitPackedLeafPairs) {
+        return false;
+    }
+
+    const auto key_bits = static_cast<unsigned>(bit_width(max(max_key_gap_, KeyGap(last_key_, key))));
+    const int64_t min_value = min(min_value_, value);
+    const auto value_bits = static_cast<unsigned>(bit_width(ValueOffset(min_value, max(max_value_, value))));
+    return EncodedBytes(num_pairs_ + 1, key_bits, value_bits) <= kPageSize;
+}
+
+void BitPackedLeaf::Add(const int64_t key, const int64_t value) {
+    if (num_pairs_ == 0) {
+        max_key_gap_ = 0;
+        min_value_ = max_value_ = value;
+    } else {
+        max_key_gap_ = max(max_key_gap_, KeyGap(last_key_, key));
+        min_value_ = min(min_value_, value);
+        max_value_ = max(max_value_, value);
+    }
+    last_key_ = key;
+    ++num_pairs_;
+}
+
+size_t BitPackedLeaf::EncodedBytes(const size_t num_pairs, const unsigned key_bits, const unsigned value_bits) {
+    const size_t num_words = kHeaderWords + NumWords(num_pairs - 1, key_bits) + NumWords(num_pairs, value_bits);
+    return num_words * sizeof(int64_t);
+}
+
+PageData BitPackedLeaf::Encode(const span<const int64_t> pairs) {
+    const size_t num_pairs = pairs.size() / 2;
+    if (num_pairs == 0) {
+        return PageData(kHeaderWords, 0);
+    }
+    const auto keys = pairs.first(num_pairs);
+    const auto values = pairs.subspan(num_pairs, num_pairs);
+
+    uint64_t max_key_gap = 0;
+    for (size_t i = 1; i < num_pairs; i++) {
+        max_key_gap = max(max_key_gap, KeyGap(keys[i - 1], keys[i]));
+    }
+    const auto [min_value, max_value] = ranges::minmax(values);
+    const auto key_bits = static_cast<unsigned>(bit_width(max_key_gap));
+    const auto value_bits = static_cast<unsigned>(bit_width(ValueOffset(min_value, max_value)));
+
+    PageData words(EncodedBytes(num_pairs, key_bits, value_bits) / sizeof(int64_t), 0);
+    words[0] = static_cast<int64_t>(num_pairs | static_cast<uint64_t>(key_bits) << 32 |
+                                    static_cast<uint64_t>(value_bits) << 40);
+    words[1] = keys[0];
+    words[2] = min_value;
+
+    int64_t *key_words = words.data() + kHeaderWords;
+    for (size_t i = 1; i < num_pairs; i++) {
+        Pack(key_words, (i - 1) * key_bits, KeyGap(keys[i - 1], keys[i]), key_bits);
+    }
+
+    int64_t *value_words = key_words + NumWords(num_pairs - 1, key_bits);
+    for (size_t i = 0; i < num_pairs; i++) {
+        Pack(value_words, i * value_bits, ValueOffset(min_value, values[i]), value_bits);
+    }
+    return words;
+}
+
+bool BitPackedLeaf::Decode(const span<const int64_t> words, PageData &pairs) {
+    if (words.size() < kHeaderWords) {
+        return false;
+    }
+    const auto header = static_cast<uint64_t>(words[0]);
+    const size_t num_pairs = header & 0xffffffff;
+    const auto key_bits = static_cast<unsigned>(header >> 32 & 0xff);
+    const auto value_bits = static_cast<unsigned>(header >> 40 & 0xff);
+    if (num_pairs == 0) {
+        pairs.clear();
+        return true;
+    }
+    if (num_pairs > kMaxBitPackedLeafPairs || key_bits > 64 || value_bits > 64 ||
+        EncodedBytes(num_pairs, key_bits, value_bits) > words.size() * sizeof(int64_t)) {
+        return false;
+    }
+
+    // Gaps and value offsets are unpacked where their keys and values go, then turned into them in place
+    pairs.resize(num_pairs * 2);
+    const auto keys = reinterpret_cast<uint64_t *>(pairs.data());
+    const auto values = keys + num_pairs;
+    const int64_t *key_words = words.data() + kHeaderWords;
+    Unpack(key_words, num_pairs - 1, key_bits, keys + 1);
+    Unpack(key_words + NumWords(num_pairs - 1, key_bits), num_pairs, value_bits, values);
+
+    // Keys are the running sum of the gaps from the first key
+    keys[0] = static_cast<uint64_t>(words[1]);
+    for (size_t i = 1; i < num_pairs; i++) {
+        keys[i] += keys[i - 1] + 1;
+    }
+
+    const auto min_value = static_cast<uint64_t>(words[2]);
+    for (size_t i = 0; i < num_pairs; i++) {
+        values[i] += min_value;
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+//
+// Created by Kiiro Huang on 2024-12-02.
+//
+
+#include "../include/bloom_filter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../external/MurmurHash3.h"
+
+BloomFilter::BloomFilter(const size_t num_keys, const size_t bits_per_key) {
+    // At least one word, so that a filter built for no key still answers MayContain
+    const size_t num_bits = max(static_cast<size_t>(64), num_keys * bits_per_key);
+    bits_.assign((num_bits + 63) / 64, 0);
+
+    // k = ln2 * m / n minimizes the false positive rate
+    num_hashes_ = clamp(static_cast<size_t>(round(bits_per_key * M_LN2)), static_cast<size_t>(1),
+                        static_cast<size_t>(30));
+}
+
+BloomFilter::BloomFilter(vector<uint64_t> bits, const size_t num_hashes) :
+    bits_(std::move(bits)), num_hashes_(num_hashes) {}
+
+void BloomFilter::Hash(const int64_t key, uint64_t &h1, uint64_t &h2) {
+    uint64_t hash[2];
+    MurmurHash3_x64_128(&key, sizeof(key), kBloomSeed, hash);
+    h1 = hash[0];
+    h2 = hash[1];
+}
+
+void BloomFilter::Put(const int64_t key) {
+    if (Empty()) {
+        return;
+    }
+
+    uint64_t h1, h2;
+    Hash(key, h1, h2);
+
+    const size_t num_bits = NumBits();
+    for (size_t i = 0; i < num_hashes_; ++i) {
+        const size_t bit = (h1 + i * h2) % num_bits;
+        bits_[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+bool BloomFilter::MayContain(const int64_t key) const {
+    if (Empty()) {
+        return true;
+    }
+
+    uint64_t h1, h2;
+    Hash(key, h1, h2);
+
+    const size_t num_bits = NumBits();
+    for (size_t i = 0; i < num_hashes_; ++i) {
+        const size_t bit = (h1 + i * h2) % num_bits;
+        if ((bits_[bit / 64] & 1ULL << (bit % 64)) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
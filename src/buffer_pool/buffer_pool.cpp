@@ -4,172 +4,110 @@
 
 #include "../../include/buffer_pool/buffer_pool.h"
 
+#include <algorithm>
 #include <iostream>
 
-#include "../../external/MurmurHash3.h"
-#include "../../utils/constants.h"
 #include "../../utils/log.h"
 
-BufferPool::BufferPool(const size_t capacity) : capacity_(capacity), size_(0) {
-    buckets_ = new vector<BucketNode *>(capacity_);
+BufferPool::BufferPool(const size_t capacity, size_t num_shards, const EvictionPolicyType policy_type) :
+    capacity_(capacity), policy_type_(policy_type), scan_ring_(kScanRingPages) {
+    num_shards = max(static_cast<size_t>(1), min(num_shards, capacity / (kMinShardPages * kPageSize)));
 
-    // set the LRU queue size to that of the buffer pool - 1
-    eviction_policy_ = new LRU(capacity_ - 1);
+    for (size_t i = 0; i < num_shards; i++) {
+        shards_.push_back(new BufferPoolShard(ShardCapacity(i, num_shards), policy_type));
+    }
 }
 
 BufferPool::~BufferPool() {
-    for (auto &head: *buckets_) {
-        while (head) {
-            const BucketNode *temp = head;
-            head = head->next_;
-            delete temp->page_;
-            delete temp;
-        }
+    for (const auto shard: shards_) {
+        delete shard;
     }
+}
 
-    delete buckets_;
+BufferPoolShard *BufferPool::GetShard(const PageId id) const {
+    // High bits of the hash, the frame table of the shard probes from the low bits
+    return shards_[(HashPageId(id) >> 32) % shards_.size()];
 }
 
+PageHandle BufferPool::Get(const PageId id) const { return GetShard(id)->Get(id); }
 
-size_t BufferPool::HashFunction(const string &key) const {
-    uint64_t hash[2];
-    MurmurHash3_x64_128(key.c_str(), sizeof(&key), 17, hash);
-    return hash[0] % buckets_->size();
-}
+PageHandle BufferPool::Put(const PageId id, PageData data) { return GetShard(id)->Put(id, std::move(data)); }
 
-Page *BufferPool::FindPage(const string &id) const {
-    const size_t index = HashFunction(id);
+void BufferPool::RemoveSst(const uint32_t file_id) {
+    LOG("  Removing all pages for SST file " << file_id);
 
-    const BucketNode *current = (*buckets_)[index];
-    while (current) {
-        if (current->page_->id_ == id) {
-            return current->page_;
-        }
-        current = current->next_;
+    // Pages of one SST are spread over every shard
+    for (const auto shard: shards_) {
+        shard->RemoveSst(file_id);
     }
+    scan_ring_.RemoveSst(file_id);
 
-    return nullptr;
+    LOG("  Finished removing all pages for SST file " << file_id);
 }
 
-Page *BufferPool::Get(const string &page_id) const {
-    const auto page = FindPage(page_id);
-    if (page) {
-        LOG("  Page " << page_id << " hit in buffer pool");
-        eviction_policy_->Update(page);
-        return page;
+void BufferPool::Clear() {
+    for (const auto shard: shards_) {
+        shard->Clear();
     }
-    LOG("    Page " << page_id << " does not hit in buffer pool");
-    return nullptr;
+    scan_ring_.Clear();
+
+    LOG("  Buffer pool cleared");
 }
 
-Page *BufferPool::Put(const string &id, const vector<int64_t> &data) {
-    if (Page *exist_page = FindPage(id)) {
-        return exist_page;
+void BufferPool::SetEvictionPolicy(const EvictionPolicyType policy_type) {
+    if (policy_type == policy_type_) {
+        return;
     }
+    policy_type_ = policy_type;
 
-    // if buffer pool is at the threshold, apply eviction policy
-    if (size_ >= capacity_ * kCoeffBufferPool) {
-        Remove();
+    for (const auto shard: shards_) {
+        shard->SetEvictionPolicy(policy_type);
     }
-
-    Page *new_page = new Page(id, data);
-
-    const size_t index = HashFunction(id);
-    BucketNode *new_node = new BucketNode(new_page);
-    new_node->next_ = (*buckets_)[index];
-    (*buckets_)[index] = new_node;
-
-    ++size_;
-
-    // maintain the LRU queue
-    eviction_policy_->Put(index, new_page);
-
-    return new_page;
 }
 
-void BufferPool::Remove() {
-    // if the LRU queue is empty, return
-    if (!eviction_policy_->front_)
-        return;
-
-    // get the page to remove
-    const Page *page_to_remove = eviction_policy_->front_->page_;
-    // remove the page from the LRU queue
-    eviction_policy_->Evict();
-    LOG("    Removing page " << page_to_remove->id_ << " from buffer pool");
-
-    // remove the page from the buffer pool
-    const size_t index = HashFunction(page_to_remove->id_);
-    BucketNode *current = (*buckets_)[index];
-    BucketNode *prev = nullptr;
-
-    while (current) {
-        if (current->page_ == page_to_remove) {
-            if (prev) {
-                prev->next_ = current->next_;
-            } else {
-                (*buckets_)[index] = current->next_;
-            }
-            delete current->page_;
-            delete current;
-            --size_;
-            return;
-        }
-        prev = current;
-        current = current->next_;
+double BufferPool::HitRate() const {
+    size_t num_hits = 0;
+    size_t num_reads = 0;
+    for (const auto shard: shards_) {
+        lock_guard lock(shard->mutex_);
+        num_hits += shard->num_hits_;
+        num_reads += shard->num_hits_ + shard->num_misses_;
     }
+    return num_reads == 0 ? 0 : static_cast<double>(num_hits) / num_reads;
 }
 
-void BufferPool::RemoveLevel(int64_t level) {
-    LOG("  Removing all pages for level: " << level);
-
-    for (auto &bucket: *buckets_) {
-        BucketNode *current = bucket;
-        BucketNode *prev = nullptr;
-
-        while (current) {
-            Page *page = current->page_;
-
-            if (page->eviction_policy_key_ == level) {
-                eviction_policy_->EvictPage(page);
+void BufferPool::ResetStats() {
+    for (const auto shard: shards_) {
+        shard->ResetStats();
+    }
+}
 
-                if (prev) {
-                    prev->next_ = current->next_;
-                } else {
-                    bucket = current->next_;
-                }
+size_t BufferPool::ShardCapacity(const size_t shard_index, const size_t num_shards) const {
+    // The first capacity_ % num_shards shards take one more byte
+    return capacity_ / num_shards + (shard_index < capacity_ % num_shards ? 1 : 0);
+}
 
-                delete current->page_;
-                BucketNode *temp = current;
-                current = current->next_;
-                delete temp;
+void BufferPool::Resize(const size_t capacity) {
+    LOG("  Resizing buffer pool from " << capacity_ << " to " << capacity << " bytes");
 
-                --size_;
-            } else {
-                prev = current;
-                current = current->next_;
-            }
-        }
+    capacity_ = capacity;
+    for (size_t i = 0; i < shards_.size(); i++) {
+        shards_[i]->Resize(ShardCapacity(i, shards_.size()));
     }
-
-    LOG("  Finished removing all pages for level: " << level);
 }
 
-void BufferPool::Clear() {
-    for (auto &head: *buckets_) {
-        while (head) {
-            const BucketNode *temp = head;
-            head = head->next_;
-            delete temp->page_;
-            delete temp;
-        }
-        head = nullptr;
+size_t BufferPool::Size() const {
+    size_t size = 0;
+    for (const auto shard: shards_) {
+        size += shard->Size();
     }
-    size_ = 0;
-
-    eviction_policy_->Clear();
-
-    LOG("  Buffer pool cleared");
+    return size;
 }
 
-void BufferPool::Resize() {}
+size_t BufferPool::Bytes() const {
+    size_t bytes = 0;
+    for (const auto shard: shards_) {
+        bytes += shard->Bytes();
+    }
+    return bytes;
+}
@@ -0,0 +1,165 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#include "../../include/buffer_pool/buffer_pool_shard.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "../../utils/constants.h"
+#include "../../utils/log.h"
+
+BufferPoolShard::BufferPoolShard(const size_t capacity, const EvictionPolicyType policy_type) :
+    capacity_(capacity), size_(0) {
+    eviction_policy_ = EvictionPolicy::Create(policy_type, MaxPages());
+}
+
+BufferPoolShard::~BufferPoolShard() {
+    eviction_policy_->Clear();
+    frames_.ForEach(ReleasePage);
+
+    delete eviction_policy_;
+}
+
+PageHandle BufferPoolShard::Get(const PageId page_id) const {
+    lock_guard lock(mutex_);
+
+    const auto page = frames_.Find(page_id);
+    if (page) {
+        LOG("  Page " << page_id << " hit in buffer pool");
+        ++num_hits_;
+        eviction_policy_->Touch(page);
+        return PageHandle(page);
+    }
+    LOG("    Page " << page_id << " does not hit in buffer pool");
+    ++num_misses_;
+    return {};
+}
+
+PageHandle BufferPoolShard::Put(const PageId id, PageData data) {
+    lock_guard lock(mutex_);
+
+    if (Page *exist_page = frames_.Find(id)) {
+        return PageHandle(exist_page);
+    }
+
+    // Evict until the new page fits in the budget
+    const size_t bytes = PageBytes(data);
+    while (BytesLocked() + bytes > capacity_ && RemoveLocked()) {
+    }
+
+    // The buffer pool holds one pin for as long as it caches the page
+    Page *new_page = new Page(id, std::move(data));
+    new_page->pin_count_ = 1;
+
+    frames_.Insert(new_page);
+    ++size_;
+    page_bytes_ += bytes;
+
+    // maintain the queues of the eviction policy
+    eviction_policy_->Put(id, new_page);
+
+    return PageHandle(new_page);
+}
+
+void BufferPoolShard::Remove() {
+    lock_guard lock(mutex_);
+    RemoveLocked();
+}
+
+bool BufferPoolShard::RemoveLocked() {
+    // the page picked by the eviction policy among those not pinned by any PageHandle
+    Page *page_to_remove = eviction_policy_->Victim();
+
+    // if no page is cached or every page is pinned, return
+    if (!page_to_remove)
+        return false;
+
+    eviction_policy_->EvictPage(page_to_remove);
+    LOG("    Removing page " << page_to_remove->id_ << " from buffer pool");
+
+    // remove the page from the buffer pool
+    frames_.Erase(page_to_remove->id_);
+    page_bytes_ -= PageBytes(page_to_remove->data_);
+    ReleasePage(page_to_remove);
+    --size_;
+
+    return true;
+}
+
+void BufferPoolShard::RemoveSst(const uint32_t file_id) {
+    lock_guard lock(mutex_);
+
+    // The upper 32 bits of a page id are the file id of its SST
+    vector<Page *> pages;
+    frames_.ForEach([&](Page *page) {
+        if (FileIdOf(page->id_) == file_id) {
+            pages.push_back(page);
+        }
+    });
+
+    for (Page *page: pages) {
+        eviction_policy_->EvictPage(page);
+        frames_.Erase(page->id_);
+        page_bytes_ -= PageBytes(page->data_);
+        ReleasePage(page);
+        --size_;
+    }
+}
+
+void BufferPoolShard::Clear() {
+    lock_guard lock(mutex_);
+
+    // Pages pinned by a PageHandle outlive the pool, unlink them from the queue first
+    eviction_policy_->Clear();
+
+    frames_.ForEach(ReleasePage);
+    frames_.Clear();
+    size_ = 0;
+    page_bytes_ = 0;
+}
+
+void BufferPoolShard::SetEvictionPolicy(const EvictionPolicyType policy_type) {
+    lock_guard lock(mutex_);
+
+    // The pages are dropped along with the queues of the old policy
+    eviction_policy_->Clear();
+    frames_.ForEach(ReleasePage);
+    frames_.Clear();
+    size_ = 0;
+    page_bytes_ = 0;
+
+    delete eviction_policy_;
+    eviction_policy_ = EvictionPolicy::Create(policy_type, MaxPages());
+}
+
+void BufferPoolShard::ResetStats() {
+    lock_guard lock(mutex_);
+    num_hits_ = 0;
+    num_misses_ = 0;
+}
+
+void BufferPoolShard::Resize(const size_t capacity) {
+    lock_guard lock(mutex_);
+
+    capacity_ = capacity;
+    eviction_policy_->Resize(MaxPages());
+
+    // Pinned pages stay cached until their handles go away and the next Put evicts them
+    while (BytesLocked() > capacity_ && RemoveLocked()) {
+    }
+    frames_.Shrink();
+}
+
+size_t BufferPoolShard::Size() const {
+    lock_guard lock(mutex_);
+    return size_;
+}
+
+size_t BufferPoolShard::Bytes() const {
+    lock_guard lock(mutex_);
+    return BytesLocked();
+}
+
+size_t BufferPoolShard::MaxPages() const { return max(static_cast<size_t>(1), capacity_ / (kPageSize + sizeof(Page))); }
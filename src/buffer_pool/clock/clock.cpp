@@ -0,0 +1,53 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#include "../../../include/buffer_pool/clock/clock.h"
+
+Clock::~Clock() { Clock::Clear(); }
+
+void Clock::Put(const PageId key, Page *page) {
+    if (page->queue_node_) {
+        Touch(page);
+        return;
+    }
+
+    // A new page goes right behind the hand, the hand reaches it last
+    auto *new_node = new ClockNode(key, page);
+    ring_.PushBack(new_node);
+    page->queue_node_ = new_node;
+}
+
+void Clock::Touch(Page *page) {
+    if (page->queue_node_) {
+        static_cast<ClockNode *>(page->queue_node_)->is_referenced_ = true;
+    }
+}
+
+Page *Clock::Victim() {
+    // Within two turns every reference bit is cleared, only pinned pages are left after that
+    for (size_t i = 0; i < ring_.size_ * 2; i++) {
+        auto *node = static_cast<ClockNode *>(ring_.front_);
+        if (!node->is_referenced_ && !IsPinned(node->page_)) {
+            return node->page_;
+        }
+
+        // Clear the bit and move the hand past the page
+        node->is_referenced_ = false;
+        ring_.MoveToTail(node);
+    }
+    return nullptr;
+}
+
+void Clock::EvictPage(Page *page) {
+    QueueNode *node = page->queue_node_;
+    if (!node) {
+        return;
+    }
+
+    ring_.Remove(node);
+    page->queue_node_ = nullptr;
+    delete node;
+}
+
+void Clock::Clear() { DeleteNodes(ring_); }
@@ -0,0 +1,33 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#include "../../include/buffer_pool/eviction_policy.h"
+
+#include "../../include/buffer_pool/clock/clock.h"
+#include "../../include/buffer_pool/lru/lru.h"
+#include "../../include/buffer_pool/lru_k/lru_k.h"
+#include "../../include/buffer_pool/two_q/two_q.h"
+
+EvictionPolicy *EvictionPolicy::Create(const EvictionPolicyType type, const size_t capacity) {
+    switch (type) {
+        case EvictionPolicyType::kClock:
+            return new Clock();
+        case EvictionPolicyType::kTwoQ:
+            return new TwoQ(capacity);
+        case EvictionPolicyType::kLRUK:
+            return new LruK(capacity);
+        case EvictionPolicyType::kLRU:
+        default:
+            return new LRU();
+    }
+}
+
+void EvictionPolicy::DeleteNodes(PageQueue &queue) {
+    while (queue.front_) {
+        QueueNode *node = queue.front_;
+        queue.Remove(node);
+        node->page_->queue_node_ = nullptr;
+        delete node;
+    }
+}
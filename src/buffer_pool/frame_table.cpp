@@ -0,0 +1,97 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#include "../../include/buffer_pool/frame_table.h"
+
+#include "../../utils/constants.h"
+
+FrameTable::FrameTable() : slots_(kMinFrameTableSlots), mask_(kMinFrameTableSlots - 1) {}
+
+size_t FrameTable::Home(const PageId id) const {
+    // Low bits of the hash, the buffer pool picks the shard with the high bits
+    return HashPageId(id) & mask_;
+}
+
+Page *FrameTable::Find(const PageId id) const {
+    for (size_t i = Home(id);; i = (i + 1) & mask_) {
+        const Slot &slot = slots_[i];
+        if (!slot.page_) {
+            return nullptr;
+        }
+        if (slot.id_ == id) {
+            return slot.page_;
+        }
+    }
+}
+
+void FrameTable::Insert(Page *page) {
+    if (static_cast<double>(size_ + 1) > static_cast<double>(slots_.size()) * kMaxFrameTableLoad) {
+        Rehash(slots_.size() * 2);
+    }
+
+    size_t i = Home(page->id_);
+    while (slots_[i].page_) {
+        i = (i + 1) & mask_;
+    }
+    slots_[i] = {page->id_, page};
+    ++size_;
+}
+
+Page *FrameTable::Erase(const PageId id) {
+    size_t i = Home(id);
+    while (slots_[i].page_ && slots_[i].id_ != id) {
+        i = (i + 1) & mask_;
+    }
+    Page *page = slots_[i].page_;
+    if (!page) {
+        return nullptr;
+    }
+
+    // Move back every following slot whose home is not in (i, j], until an empty slot ends the run
+    for (size_t j = (i + 1) & mask_; slots_[j].page_; j = (j + 1) & mask_) {
+        const size_t home = Home(slots_[j].id_);
+        const bool stays = i <= j ? i < home && home <= j : i < home || home <= j;
+        if (!stays) {
+            slots_[i] = slots_[j];
+            i = j;
+        }
+    }
+    slots_[i] = Slot();
+    --size_;
+
+    return page;
+}
+
+void FrameTable::Clear() {
+    slots_.assign(kMinFrameTableSlots, Slot());
+    mask_ = kMinFrameTableSlots - 1;
+    size_ = 0;
+}
+
+void FrameTable::Shrink() {
+    size_t num_slots = slots_.size();
+    while (num_slots / 2 >= kMinFrameTableSlots &&
+           static_cast<double>(size_) <= static_cast<double>(num_slots / 2) * kMaxFrameTableLoad / 2) {
+        num_slots /= 2;
+    }
+    if (num_slots < slots_.size()) {
+        Rehash(num_slots);
+    }
+}
+
+void FrameTable::Rehash(const size_t num_slots) {
+    vector<Slot> old_slots(num_slots);
+    swap(slots_, old_slots);
+    mask_ = slots_.size() - 1;
+
+    for (const Slot &slot: old_slots) {
+        if (slot.page_) {
+            size_t i = Home(slot.id_);
+            while (slots_[i].page_) {
+                i = (i + 1) & mask_;
+            }
+            slots_[i] = slot;
+        }
+    }
+}
@@ -0,0 +1,106 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#include "../../../include/buffer_pool/lru_k/lru_k.h"
+
+#include <algorithm>
+
+LruK::LruK(const size_t capacity) { LruK::Resize(capacity); }
+
+LruK::~LruK() { LruK::Clear(); }
+
+void LruK::Read(LruKNode *node) {
+    if (node->history_[0] > 0) {
+        order_.erase(OrderKey(node));
+    }
+
+    shift_right(node->history_.begin(), node->history_.end(), 1);
+    node->history_[0] = ++time_;
+
+    order_.emplace(OrderKey(node), node->page_);
+}
+
+void LruK::Put(const PageId key, Page *page) {
+    if (page->queue_node_) {
+        Touch(page);
+        return;
+    }
+
+    auto *new_node = new LruKNode(key, page);
+    page->queue_node_ = new_node;
+
+    // Evicted not long ago, the page keeps its earlier reads
+    if (const auto it = retained_.find(key); it != retained_.end()) {
+        new_node->history_ = it->second;
+        retained_.erase(it);
+    }
+
+    Read(new_node);
+}
+
+void LruK::Touch(Page *page) {
+    if (page->queue_node_) {
+        Read(static_cast<LruKNode *>(page->queue_node_));
+    }
+}
+
+Page *LruK::Victim() {
+    for (const auto &[order_key, page]: order_) {
+        if (!IsPinned(page)) {
+            return page;
+        }
+    }
+    return nullptr;
+}
+
+void LruK::EvictPage(Page *page) {
+    const auto node = static_cast<LruKNode *>(page->queue_node_);
+    if (!node) {
+        return;
+    }
+
+    order_.erase(OrderKey(node));
+
+    // The most recent read tells this eviction apart from later ones of the same page
+    retained_[node->key_] = node->history_;
+    retained_order_.emplace_back(node->key_, node->history_[0]);
+    TrimRetained();
+
+    page->queue_node_ = nullptr;
+    delete node;
+}
+
+void LruK::TrimRetained() {
+    while (retained_order_.size() > max_retained_) {
+        const auto [oldest_key, last_read] = retained_order_.front();
+        retained_order_.pop_front();
+
+        const auto it = retained_.find(oldest_key);
+        if (it != retained_.end() && it->second[0] == last_read) {
+            retained_.erase(it);
+        }
+    }
+}
+
+void LruK::Clear() {
+    for (const auto &[order_key, page]: order_) {
+        delete page->queue_node_;
+        page->queue_node_ = nullptr;
+    }
+    order_.clear();
+    retained_.clear();
+    retained_order_.clear();
+}
+
+size_t LruK::Bytes() const {
+    return order_.size() * (sizeof(LruKNode) + TreeNodeBytes(sizeof(pair<pair<uint64_t, uint64_t>, Page *>))) +
+           retained_order_.size() * sizeof(pair<PageId, uint64_t>) +
+           retained_.size() * HashNodeBytes(sizeof(pair<PageId, ReadHistory>)) +
+           retained_.bucket_count() * sizeof(void *);
+}
+
+void LruK::Resize(const size_t capacity) {
+    max_retained_ = max(static_cast<size_t>(1), capacity);
+    TrimRetained();
+}
@@ -0,0 +1,83 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#include "../../include/buffer_pool/scan_ring.h"
+
+#include <algorithm>
+
+ScanRing::ScanRing(const size_t num_frames) : frames_(max(static_cast<size_t>(1), num_frames), nullptr) {}
+
+ScanRing::~ScanRing() { Clear(); }
+
+PageHandle ScanRing::Get(const PageId id) const {
+    lock_guard lock(mutex_);
+
+    for (Page *page: frames_) {
+        if (page && page->id_ == id) {
+            return PageHandle(page);
+        }
+    }
+    return {};
+}
+
+PageData ScanRing::TakeBuffer(const size_t size) {
+    lock_guard lock(mutex_);
+
+    // Only the ring holds the page, new pins are only taken through Get under mutex_
+    Page *page = frames_[hand_];
+    if (!page || page->pin_count_ > 1) {
+        return PageData(size);
+    }
+
+    PageData buffer = std::move(page->data_);
+    frames_[hand_] = nullptr;
+    ReleasePage(page);
+
+    buffer.resize(size);
+    return buffer;
+}
+
+PageHandle ScanRing::Put(const PageId id, PageData data) {
+    lock_guard lock(mutex_);
+
+    // The ring holds one pin for as long as the page is in a frame
+    Page *new_page = new Page(id, std::move(data));
+    new_page->pin_count_ = 1;
+
+    if (frames_[hand_]) {
+        ReleasePage(frames_[hand_]);
+    }
+    frames_[hand_] = new_page;
+    hand_ = (hand_ + 1) % frames_.size();
+
+    return PageHandle(new_page);
+}
+
+void ScanRing::RemoveSst(const uint32_t file_id) {
+    lock_guard lock(mutex_);
+
+    for (Page *&page: frames_) {
+        if (page && FileIdOf(page->id_) == file_id) {
+            ReleasePage(page);
+            page = nullptr;
+        }
+    }
+}
+
+void ScanRing::Clear() {
+    lock_guard lock(mutex_);
+
+    for (Page *&page: frames_) {
+        if (page) {
+            ReleasePage(page);
+            page = nullptr;
+        }
+    }
+    hand_ = 0;
+}
+
+size_t ScanRing::Size() const {
+    lock_guard lock(mutex_);
+    return ranges::count_if(frames_, [](const Page *page) { return page != nullptr; });
+}
@@ -0,0 +1,117 @@
+//
+// Created by Kiiro Huang on 2024-12-08.
+//
+
+#include "../../../include/buffer_pool/two_q/two_q.h"
+
+#include <algorithm>
+
+#include "../../../utils/constants.h"
+
+TwoQ::TwoQ(const size_t capacity) { TwoQ::Resize(capacity); }
+
+TwoQ::~TwoQ() { TwoQ::Clear(); }
+
+void TwoQ::Put(const PageId key, Page *page) {
+    if (page->queue_node_) {
+        Touch(page);
+        return;
+    }
+
+    auto *new_node = new TwoQNode(key, page);
+    page->queue_node_ = new_node;
+
+    // Read again since it was evicted from A1in, the page is hot
+    if (a1out_ids_.erase(key)) {
+        new_node->is_hot_ = true;
+        am_.PushBack(new_node);
+        return;
+    }
+
+    a1in_.PushBack(new_node);
+}
+
+void TwoQ::Touch(Page *page) {
+    const auto node = static_cast<TwoQNode *>(page->queue_node_);
+
+    // Reads of a page in A1in are taken as correlated with the first one
+    if (node && node->is_hot_) {
+        am_.MoveToTail(node);
+    }
+}
+
+Page *TwoQ::FirstUnpinned(const PageQueue &queue) {
+    for (const QueueNode *node = queue.front_; node; node = node->next_) {
+        if (!IsPinned(node->page_)) {
+            return node->page_;
+        }
+    }
+    return nullptr;
+}
+
+Page *TwoQ::Victim() {
+    // Take from A1in while it is over its share, else from Am, falling back to the other queue when all are pinned
+    Page *victim = a1in_.size_ > max_a1in_ || am_.size_ == 0 ? FirstUnpinned(a1in_) : FirstUnpinned(am_);
+    if (!victim) {
+        victim = FirstUnpinned(a1in_);
+    }
+    if (!victim) {
+        victim = FirstUnpinned(am_);
+    }
+    return victim;
+}
+
+void TwoQ::RememberEvicted(const PageId key) {
+    a1out_ids_[key] = ++num_evicted_;
+    a1out_.emplace_back(key, num_evicted_);
+    TrimA1out();
+}
+
+void TwoQ::TrimA1out() {
+    // Forget the oldest ids, unless the page was evicted again since
+    while (a1out_.size() > max_a1out_) {
+        const auto [oldest_key, eviction] = a1out_.front();
+        a1out_.pop_front();
+
+        const auto it = a1out_ids_.find(oldest_key);
+        if (it != a1out_ids_.end() && it->second == eviction) {
+            a1out_ids_.erase(it);
+        }
+    }
+}
+
+void TwoQ::EvictPage(Page *page) {
+    const auto node = static_cast<TwoQNode *>(page->queue_node_);
+    if (!node) {
+        return;
+    }
+
+    if (node->is_hot_) {
+        am_.Remove(node);
+    } else {
+        a1in_.Remove(node);
+        RememberEvicted(node->key_);
+    }
+
+    page->queue_node_ = nullptr;
+    delete node;
+}
+
+void TwoQ::Clear() {
+    DeleteNodes(a1in_);
+    DeleteNodes(am_);
+    a1out_.clear();
+    a1out_ids_.clear();
+}
+
+size_t TwoQ::Bytes() const {
+    return (a1in_.size_ + am_.size_) * sizeof(TwoQNode) + a1out_.size() * sizeof(pair<PageId, uint64_t>) +
+           a1out_ids_.size() * HashNodeBytes(sizeof(pair<PageId, uint64_t>)) +
+           a1out_ids_.bucket_count() * sizeof(void *);
+}
+
+void TwoQ::Resize(const size_t capacity) {
+    max_a1in_ = max(static_cast<size_t>(1), static_cast<size_t>(capacity * kTwoQInRatio));
+    max_a1out_ = max(static_cast<size_t>(1), static_cast<size_t>(capacity * kTwoQOutRatio));
+    TrimA1out();
+}
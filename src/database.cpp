@@ -4,34 +4,45 @@
 
 #include "../include/database.h"
 
-#include <__ranges/reverse_view.h>
 #include <algorithm>
 #include <fcntl.h>
+#include <filesystem>
+#include <ranges>
 #include <regex>
 #include <sstream>
 #include <unistd.h>
-#include <unordered_set>
 
 #include "../include/b_tree/b_tree_sstable.h"
+#include "../include/db_iterator.h"
 #include "../include/buffer_pool/buffer_pool_manager.h"
 #include "../include/lsm_tree/lsm_tree.h"
+#include "../include/merging_iterator.h"
 #include "../include/sst_counter.h"
+#include "../include/sstable_iterator.h"
+#include "../include/table_cache.h"
 #include "../utils/log.h"
 
-Database::Database(const size_t memtable_size) : memtable_(nullptr) {
-    memtable_ = new Memtable(memtable_size);
+Database::Database(const size_t memtable_size, const Options &options) : options_(options) {
+    memtable_ = make_shared<Memtable>(memtable_size);
     buffer_pool_ = BufferPoolManager::GetInstance();
 }
 
 Database::~Database() {
     {
-        delete memtable_;
+        StopBackgroundWork();
+
+        delete wal_;
 
         BufferPoolManager::GetInstance()->Clear();
     }
 }
 
 void Database::Open(const string &db_name) {
+    // The background work of a database opened before is done with its SSTs
+    StopBackgroundWork();
+    delete wal_;
+    wal_ = nullptr;
+
     db_name_ = db_name;
 
     if (!filesystem::exists(db_name)) {
@@ -44,141 +55,472 @@ void Database::Open(const string &db_name) {
     // Initialize SSTCounter with the database name, get current SST counter
     SSTCounter::GetInstance().SetDbName(db_name);
 
-    // Build LSM-Tree
-    LsmTree::GetInstance();
+    // SST files stay open across reads, up to max_open_files of them
+    TableCache::GetInstance().SetCapacity(options_.max_open_files);
+    TableCache::GetInstance().SetReadMode(options_.read_mode);
+    LsmTree::GetInstance().leaf_formats_ = options_.leaf_formats;
+    buffer_pool_->SetEvictionPolicy(options_.eviction_policy);
+    buffer_pool_->Resize(options_.buffer_pool_size);
+
+    // Build LSM-Tree from the SSTs of this database
+    // SSTCounter restarts from the files found, so the LSM-Tree is rebuilt on every open
+    LsmTree::GetInstance().BuildLsmTree();
+
+    // Writes that were only in memtables when the database crashed are back in level 0
+    ReplayLogs();
+    wal_ = new WriteAheadLog(db_name, 0, options_.wal_sync_mode, options_.wal_sync_interval_ms);
+
+    // Full memtables are flushed and full levels are merged in the background from now on
+    compaction_scheduler_ = new CompactionScheduler(LsmTree::GetInstance(), options_.max_background_compactions,
+                                                    options_.max_subcompactions);
+    compaction_scheduler_->Schedule();
+
+    is_closing_ = false;
+    flush_thread_ = thread(&Database::FlushLoop, this);
 }
 
-void Database::Close() const {
-    if (memtable_->Size() > 0) {
-        LOG("Closing database and flushing memtable to SSTs: " << db_name_);
+void Database::Close() {
+    {
+        unique_lock lock(memtable_mutex_);
+        if (memtable_->Size() > 0) {
+            LOG("Closing database and flushing memtable to SSTs: " << db_name_);
 
-        FlushFromMemtable();
-        memtable_->clear();
+            ScheduleFlush(lock);
+        }
     }
 
+    // Background work ends once the last immutable memtable is flushed and merged
+    StopBackgroundWork();
+
+    // Every write is in an SST, the log left is empty
+    delete wal_;
+    wal_ = nullptr;
+
     BufferPoolManager::GetInstance()->Clear();
 
     LOG("Database closed");
     LOG("========================================");
 }
 
-void Database::Put(const int64_t key, const int64_t value) const {
-    memtable_->Put(key, value);
+void Database::Put(const int64_t key, const int64_t value) {
+    WriteBatch batch;
+    batch.Put(key, value);
+    Write(batch);
+}
+
+void Database::Write(const WriteBatch &batch) {
+    if (batch.Count() == 0) {
+        return;
+    }
+
+    Writer writer(&batch);
+
+    unique_lock lock(memtable_mutex_);
+    writers_.push_back(&writer);
+    writer.cv.wait(lock, [&] { return writer.is_done || writers_.front() == &writer; });
+
+    // Written by the writer in front of it
+    if (writer.is_done) {
+        return;
+    }
 
+    // Group the writers queued so far, they wait while this writer logs their batches
+    size_t group_size = 0;
+    size_t num_writers = 0;
+    for (const auto queued: writers_) {
+        if (num_writers > 0 && (group_size + queued->batch->Count()) * kPairSize > kMaxGroupCommitSize) {
+            break;
+        }
+        group_size += queued->batch->Count();
+        ++num_writers;
+    }
+
+    // A group of one batch is logged as it is
+    vector<pair<int64_t, int64_t>> group;
+    if (num_writers > 1) {
+        group.reserve(group_size);
+        for (size_t i = 0; i < num_writers; ++i) {
+            const auto &pairs = writers_[i]->batch->pairs_;
+            group.insert(group.end(), pairs.begin(), pairs.end());
+        }
+    }
+
+    // New writers queue up behind the group meanwhile
+    // Reads and new iterators take the memtable mutex, they see the memtable before or after the whole group
+    lock.unlock();
+    wal_->Append(num_writers > 1 ? group : batch.pairs_);
+    lock.lock();
+
+    for (size_t i = 0; i < num_writers; ++i) {
+        for (const auto &[key, value]: writers_[i]->batch->pairs_) {
+            memtable_->Put(key, value);
+        }
+    }
+
+    // Checked once per group, a batch never spans two memtables
     if (memtable_->Size() >= memtable_->memtable_size_) {
-        LOG(" ┌Memtable is full, flushing to SST");
-        FlushFromMemtable();
-        memtable_->clear();
+        LOG(" ┌Memtable is full, handing it over to the flush thread");
+        ScheduleFlush(lock);
+    }
+
+    // Wake the writers of the group, then the writer of the next group
+    for (size_t i = 0; i < num_writers; ++i) {
+        Writer *done = writers_.front();
+        writers_.pop_front();
+        if (done != &writer) {
+            done->is_done = true;
+            done->cv.notify_one();
+        }
+    }
+    if (!writers_.empty()) {
+        writers_.front()->cv.notify_one();
     }
 }
 
 optional<int64_t> Database::Get(const int64_t key) const {
     LOG("Get key: " << key);
 
-    // Find in memtable
-    const auto value = memtable_->Get(key);
-    if (value.has_value()) {
-        // If the value is INT64_MIN, it means the key is deleted
-        if (value.value() == INT64_MIN) {
-            return nullopt;
+    // The SSTs being read are not deleted by the flush thread meanwhile
+    const LsmTree &lsm_tree = LsmTree::GetInstance();
+    shared_lock lsm_lock(lsm_tree.mutex_);
+
+    {
+        lock_guard lock(memtable_mutex_);
+
+        // Find in memtable, then in the memtable being flushed
+        for (const Memtable *memtable: {memtable_.get(), immutable_memtable_.get()}) {
+            if (!memtable) {
+                continue;
+            }
+
+            const auto value = memtable->Get(key);
+            if (value.has_value()) {
+                // If the value is INT64_MIN, it means the key is deleted
+                if (value.value() == INT64_MIN) {
+                    return nullopt;
+                }
+                return value;
+            }
         }
-        return value;
     }
 
     // Find in LSM-Tree
-    const LsmTree &lsm_tree = LsmTree::GetInstance();
 
-    // Find in SSTs from the lowest level to the highest level
+    // SSTs that may contain the key, from the lowest level to the highest level, in the same level from the newest
+    // to the oldest, key range and bloom filter are in memory, the SSTs skipped never open their files
+    vector<const BTreeSSTable *> candidates;
     for (auto &current_level: lsm_tree.levelled_sst_) {
-        // In the same level, find from the newest to the oldest
         for (const auto sst: ranges::reverse_view(current_level)) {
-            sst->fd_ = sst->EnsureFileOpen();
-            auto get_value = sst->Get(key);
-            sst->fd_ = close(sst->fd_);
+            if (sst->MayContain(key)) {
+                candidates.push_back(sst);
+            }
+        }
+    }
 
-            if (get_value.has_value()) {
-                // If the value is INT64_MIN, it means the key is deleted
-                if (get_value.value() == INT64_MIN) {
-                    return nullopt;
-                }
-                return get_value;
+    // The leaves of every candidate are read in one batch, they stay pinned until the key is found
+    vector<PageHandle> leaves;
+    if (candidates.size() > 1) {
+        vector<pair<const SSTable *, off_t>> pages;
+        for (const auto sst: candidates) {
+            if (const auto leaf_index = sst->FindLeaf(key)) {
+                pages.emplace_back(sst, sst->leaf_start_offset_ + leaf_index.value() * kPageSize);
+            }
+        }
+        leaves = SSTable::GetPages(pages);
+    }
+
+    for (const auto sst: candidates) {
+        auto get_value = sst->Get(key);
+
+        if (get_value.has_value()) {
+            // If the value is INT64_MIN, it means the key is deleted
+            if (get_value.value() == INT64_MIN) {
+                return nullopt;
             }
+            return get_value;
         }
     }
 
     return nullopt;
 }
 
-vector<pair<int64_t, int64_t>> Database::Scan(const int64_t start_key, const int64_t end_key) const {
-    LOG("Scan keys from " << start_key << " to " << end_key);
+vector<optional<int64_t>> Database::MultiGet(const span<const int64_t> keys) const {
+    vector<optional<int64_t>> values(keys.size());
 
-    vector<pair<int64_t, int64_t>> result;
-    unordered_set<int64_t> found_keys;
-
-    // Find in memtable
-    vector<pair<int64_t, int64_t>> memtable_results = memtable_->Scan(start_key, end_key);
-    // Update result and found_keys
-    for (const auto &[key, value]: memtable_results) {
-        // If the value is INT64_MIN, it means the key is deleted
-        if (value == INT64_MIN) {
-            continue;
+    // Keys not found yet, in key order, with their position in keys
+    vector<pair<int64_t, size_t>> pending;
+    pending.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        pending.emplace_back(keys[i], i);
+    }
+    ranges::sort(pending);
+
+    // A key is resolved by the newest source that has it, a tombstone resolves it as not found
+    vector<bool> is_resolved(keys.size(), false);
+    const auto resolve = [&](const size_t position, const int64_t value) {
+        is_resolved[position] = true;
+        if (value != INT64_MIN) {
+            values[position] = value;
         }
+    };
+    const auto drop_resolved = [&] {
+        erase_if(pending, [&](const pair<int64_t, size_t> &key) { return is_resolved[key.second]; });
+    };
+
+    // The SSTs being read are not deleted by the flush thread meanwhile
+    const LsmTree &lsm_tree = LsmTree::GetInstance();
+    shared_lock lsm_lock(lsm_tree.mutex_);
+
+    {
+        lock_guard lock(memtable_mutex_);
+
+        // Find in memtable, then in the memtable being flushed
+        for (const Memtable *memtable: {memtable_.get(), immutable_memtable_.get()}) {
+            if (!memtable) {
+                continue;
+            }
 
-        if (!found_keys.contains(key)) {
-            result.emplace_back(key, value);
-            found_keys.insert(key);
+            for (const auto &[key, position]: pending) {
+                const auto value = memtable->Get(key);
+                if (value.has_value()) {
+                    resolve(position, value.value());
+                }
+            }
+            drop_resolved();
         }
     }
 
-    // Find in LSM-Tree
-    const LsmTree &lsm_tree = LsmTree::GetInstance();
-
     // Find in SSTs from the lowest level to the highest level
-    for (auto &current_level: lsm_tree.levelled_sst_) {
+    for (const auto &current_level: lsm_tree.levelled_sst_) {
         // In the same level, find from the newest to the oldest
         for (const auto sst: ranges::reverse_view(current_level)) {
-            LOG("\tScan in " << sst->file_path_);
-            sst->fd_ = sst->EnsureFileOpen();
-            const auto values = sst->Scan(start_key, end_key);
-            sst->fd_ = close(sst->fd_);
+            if (pending.empty()) {
+                return values;
+            }
 
-            // Update result and found_keys
-            for (const auto &[key, value]: values) {
-                // If the value is INT64_MIN, it means the key is deleted
-                if (value == INT64_MIN) {
-                    continue;
+            // Key range and bloom filter are in memory, only the keys the SST may contain are looked up
+            vector<int64_t> sst_keys;
+            vector<size_t> positions;
+            const auto first = ranges::lower_bound(pending, make_pair(sst->min_key_, static_cast<size_t>(0)));
+            for (auto it = first; it != pending.end() && it->first <= sst->max_key_; ++it) {
+                if (sst->MayContain(it->first)) {
+                    sst_keys.push_back(it->first);
+                    positions.push_back(it->second);
                 }
+            }
+            if (sst_keys.empty()) {
+                continue;
+            }
 
-                if (!found_keys.contains(key)) {
-                    result.emplace_back(key, value);
-                    found_keys.insert(key);
+            const auto sst_values = sst->MultiGet(sst_keys);
+            for (size_t i = 0; i < sst_values.size(); ++i) {
+                if (sst_values[i].has_value()) {
+                    resolve(positions[i], sst_values[i].value());
                 }
             }
+            drop_resolved();
         }
     }
 
-    ranges::sort(result, [](const auto &a, const auto &b) { return a.first < b.first; });
+    return values;
+}
+
+vector<pair<int64_t, int64_t>> Database::Scan(const int64_t start_key, const int64_t end_key) const {
+    LOG("Scan keys from " << start_key << " to " << end_key);
+
+    vector<pair<int64_t, int64_t>> result;
+
+    shared_lock lsm_lock(LsmTree::GetInstance().mutex_);
+
+    // When the scan reads too many leaves, the pages read go through the scan ring, not the buffer pool
+    // Leaves are counted from the indexes of the SSTs, keys in the range may be sparse
+    const bool is_sequential_flooding = EstimateScanPages(start_key, end_key) >= kPageSequentialFlooding;
+
+    // Merges and flushes go on while the SSTs scanned are referenced
+    vector<shared_ptr<const Memtable>> memtables;
+    vector<BTreeSSTable *> ssts;
+    Iterator *merging_iterator =
+            NewMergingIterator(start_key, end_key, is_sequential_flooding, true, memtables, ssts);
+    lsm_lock.unlock();
+
+    // Keys come out in order, each with its newest value, no dedup or sort is needed
+    DBIterator iterator(merging_iterator, std::move(memtables), std::move(ssts));
+    for (iterator.Seek(start_key); iterator.Valid() && iterator.Key() <= end_key; iterator.Next()) {
+        result.emplace_back(iterator.Key(), iterator.Value());
+    }
 
     return result;
 }
 
-void Database::Delete(int64_t key) const {
+size_t Database::EstimateScanPages(const int64_t start_key, const int64_t end_key) const {
+    size_t num_pages = 0;
+    for (const auto &current_level: LsmTree::GetInstance().levelled_sst_) {
+        for (const auto sst: current_level) {
+            num_pages += sst->EstimateScanPages(start_key, end_key);
+        }
+    }
+    return num_pages;
+}
+
+Iterator *Database::NewIterator(const bool is_sequential_flooding) const {
+    // The iterator keeps the memtables and the SSTs it reads from alive until it is deleted, without holding
+    // the LSM-Tree
+    shared_lock lsm_lock(LsmTree::GetInstance().mutex_);
+    vector<shared_ptr<const Memtable>> memtables;
+    vector<BTreeSSTable *> ssts;
+    Iterator *merging_iterator =
+            NewMergingIterator(INT64_MIN, INT64_MAX, is_sequential_flooding, false, memtables, ssts);
+    lsm_lock.unlock();
+
+    return new DBIterator(merging_iterator, std::move(memtables), std::move(ssts));
+}
+
+Iterator *Database::NewMergingIterator(const int64_t start_key, const int64_t end_key,
+                                       const bool is_sequential_flooding, const bool is_reading_ahead,
+                                       vector<shared_ptr<const Memtable>> &memtables,
+                                       vector<BTreeSSTable *> &ssts) const {
+    // Merge memtables and SSTs in one pass, from the newest source to the oldest one
+    // The memtables are read in place, writers go on putting into the active one behind the snapshot of its iterator
+    vector<Iterator *> children;
+    {
+        lock_guard lock(memtable_mutex_);
+        for (const auto &memtable: {memtable_, immutable_memtable_}) {
+            if (memtable) {
+                children.push_back(memtable->NewIterator());
+                memtables.push_back(memtable);
+            }
+        }
+    }
+
+    // From the lowest level to the highest level
+    for (const auto &current_level: LsmTree::GetInstance().levelled_sst_) {
+        // In the same level, from the newest to the oldest
+        for (const auto sst: ranges::reverse_view(current_level)) {
+            // Skip the SSTs whose key range does not overlap [start_key, end_key]
+            if (sst->max_key_ < start_key || sst->min_key_ > end_key) {
+                continue;
+            }
+            const off_t readahead_end_offset = is_reading_ahead ? sst->ScanEndOffset(end_key) : -1;
+            children.push_back(new SSTableIterator(sst, is_sequential_flooding, readahead_end_offset));
+            LsmTree::Ref(sst);
+            ssts.push_back(sst);
+        }
+    }
+
+    return new MergingIterator(std::move(children));
+}
+
+void Database::Delete(const int64_t key) {
     // Set tombstone in memtable
     // This is enough for the delete implementation
-    memtable_->Delete(key);
+    WriteBatch batch;
+    batch.Delete(key);
+    Write(batch);
+}
+
+void Database::ResizeBufferPool(const size_t size) {
+    options_.buffer_pool_size = size;
+    buffer_pool_->Resize(size);
+}
+
+void Database::ReplayLogs() {
+    const auto log_numbers = WriteAheadLog::ListLogs(db_name_);
+    for (const auto number: log_numbers) {
+        LOG("Replaying log " << number << " of " << db_name_);
+        for (const auto &[key, value]: WriteAheadLog::ReadLog(db_name_, number)) {
+            memtable_->Put(key, value);
+        }
+    }
+
+    // The logs are removed only once their writes are in an SST, a crash meanwhile replays them again
+    if (memtable_->Size() > 0) {
+        FlushFromMemtable(memtable_.get());
+        memtable_->clear();
+    }
+    for (const auto number: log_numbers) {
+        WriteAheadLog::RemoveLog(db_name_, number);
+    }
+}
+
+void Database::ScheduleFlush(unique_lock<mutex> &lock) {
+    // One memtable is flushed at a time, writes only stall when the previous one is not flushed yet
+    flush_cv_.wait(lock, [this] { return immutable_memtable_ == nullptr; });
+
+    immutable_memtable_ = memtable_;
+    memtable_ = make_shared<Memtable>(immutable_memtable_->memtable_size_);
+    immutable_log_number_ = wal_->Roll();
+
+    flush_cv_.notify_all();
+}
+
+void Database::FlushLoop() {
+    LsmTree &lsm_tree = LsmTree::GetInstance();
+
+    unique_lock lock(memtable_mutex_);
+    while (true) {
+        flush_cv_.wait(lock, [this] { return immutable_memtable_ != nullptr || is_closing_; });
+
+        // Closing, and every memtable is flushed
+        if (!immutable_memtable_) {
+            return;
+        }
+
+        // Reads keep finding the keys in the immutable memtable while its SST is written
+        shared_ptr<const Memtable> immutable_memtable = immutable_memtable_;
+        const int64_t log_number = immutable_log_number_;
+        lock.unlock();
+
+        // Writes stall here, not in Put, when merges fall behind
+        compaction_scheduler_->WaitForLevel0();
+
+        FlushFromMemtable(immutable_memtable.get());
+
+        {
+            // Reads holding the LSM-Tree shared find the keys in the immutable memtable or in its SST, not neither
+            unique_lock lsm_lock(lsm_tree.mutex_);
+            lock.lock();
+            immutable_memtable_ = nullptr;
+            lock.unlock();
+        }
+        // Iterators still reading the memtable keep it alive
+        immutable_memtable.reset();
+
+        // The writes of the immutable memtable are durable in its SST
+        WriteAheadLog::RemoveLog(db_name_, log_number);
+
+        // Stalled writes go on, full levels are merged by the compaction workers
+        flush_cv_.notify_all();
+        compaction_scheduler_->Schedule();
+
+        lock.lock();
+    }
 }
 
-void Database::FlushFromMemtable() const {
+void Database::FlushFromMemtable(const Memtable *memtable) const {
     // Flush to level 0 of LSM-Tree
     const string db_name = SSTCounter::GetInstance().GetDbName();
     const auto b_tree_sst = new BTreeSSTable(db_name, true);
     LOG(" | Flushing to SST: " << b_tree_sst->file_path_);
 
     // 1 memtable -> 1 SSTable
-    const auto data = memtable_->Traverse();
-    b_tree_sst->FlushToStorage(&data);
+    const auto data = memtable->Traverse();
+    b_tree_sst->FlushToStorage(&data, LsmTree::GetInstance().GetLeafFormat(0));
 
-    LsmTree &lsm_tree = LsmTree::GetInstance();
-    lsm_tree.AddSst(b_tree_sst);
-    lsm_tree.OrderLsmTree();
+    LsmTree::GetInstance().AddSst(b_tree_sst);
+}
+
+void Database::StopBackgroundWork() {
+    if (flush_thread_.joinable()) {
+        {
+            lock_guard lock(memtable_mutex_);
+            is_closing_ = true;
+        }
+        flush_cv_.notify_all();
+
+        flush_thread_.join();
+    }
+
+    // No SST is added anymore, the scheduler stops once every full level is merged
+    delete compaction_scheduler_;
+    compaction_scheduler_ = nullptr;
 }
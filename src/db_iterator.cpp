@@ -0,0 +1,33 @@
+//
+// Created by Kiiro Huang on 2024-12-05.
+//
+
+#include "../include/db_iterator.h"
+
+#include "../include/lsm_tree/lsm_tree.h"
+#include "../include/memtable.h"
+
+DBIterator::~DBIterator() {
+    // Pages of the SSTs are unpinned before the SSTs are released, memtables are released with memtables_
+    delete iterator_;
+    for (const auto sst: ssts_) {
+        LsmTree::GetInstance().Unref(sst);
+    }
+}
+
+void DBIterator::Seek(const int64_t key) {
+    iterator_->Seek(key);
+    SkipTombstones();
+}
+
+void DBIterator::Next() {
+    iterator_->Next();
+    SkipTombstones();
+}
+
+void DBIterator::SkipTombstones() const {
+    // If the value is INT64_MIN, it means the key is deleted
+    while (iterator_->Valid() && iterator_->Value() == INT64_MIN) {
+        iterator_->Next();
+    }
+}
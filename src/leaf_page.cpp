@@ -0,0 +1,153 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#include "../include/leaf_page.h"
+
+#include <bit>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define HAS_X86_SIMD
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define HAS_NEON
+#endif
+
+namespace {
+// Columnar keys left once the branchless search narrows the range down, 2 cache lines compared with SIMD
+constexpr size_t kSimdSearchKeys = 16;
+
+// Number of keys less than key among num_keys keys
+using CountLessFn = size_t (*)(const int64_t *keys, size_t num_keys, int64_t key);
+
+size_t CountLessScalar(const int64_t *keys, const size_t num_keys, const int64_t key) {
+    size_t count = 0;
+    for (size_t i = 0; i < num_keys; i++) {
+        count += keys[i] < key;
+    }
+    return count;
+}
+
+#ifdef HAS_X86_SIMD
+// 4 keys per compare, one bit per key in the mask
+__attribute__((target("avx2"))) size_t CountLessAvx2(const int64_t *keys, const size_t num_keys, const int64_t key) {
+    const __m256i target = _mm256_set1_epi64x(key);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 4 <= num_keys; i += 4) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+        const __m256i is_less = _mm256_cmpgt_epi64(target, block);
+        count += popcount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(is_less))));
+    }
+    return count + CountLessScalar(keys + i, num_keys - i, key);
+}
+
+// 2 keys per compare, pcmpgtq came with SSE4.2
+__attribute__((target("sse4.2"))) size_t CountLessSse42(const int64_t *keys, const size_t num_keys,
+                                                        const int64_t key) {
+    const __m128i target = _mm_set1_epi64x(key);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 2 <= num_keys; i += 2) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+        const __m128i is_less = _mm_cmpgt_epi64(target, block);
+        count += popcount(static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(is_less))));
+    }
+    return count + CountLessScalar(keys + i, num_keys - i, key);
+}
+#endif
+
+#ifdef HAS_NEON
+// 2 keys per compare, a key less than the target sets its lane to all ones, which is -1
+size_t CountLessNeon(const int64_t *keys, const size_t num_keys, const int64_t key) {
+    const int64x2_t target = vdupq_n_s64(key);
+    uint64x2_t counts = vdupq_n_u64(0);
+    size_t i = 0;
+    for (; i + 2 <= num_keys; i += 2) {
+        counts = vsubq_u64(counts, vcltq_s64(vld1q_s64(keys + i), target));
+    }
+    return vgetq_lane_u64(counts, 0) + vgetq_lane_u64(counts, 1) + CountLessScalar(keys + i, num_keys - i, key);
+}
+#endif
+
+struct Search {
+    const char *name;
+    CountLessFn count_less;
+};
+
+// The widest SIMD the CPU running the process has, the binary may be built for an older one
+Search PickSearch() {
+#ifdef HAS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {"avx2", CountLessAvx2};
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return {"sse4.2", CountLessSse42};
+    }
+#endif
+#ifdef HAS_NEON
+    // Every AArch64 CPU has NEON
+    return {"neon", CountLessNeon};
+#endif
+    return {"scalar", CountLessScalar};
+}
+
+const Search &GetSearch() {
+    static const Search search = PickSearch();
+    return search;
+}
+} // namespace
+
+LeafPage::LeafPage(const span<const int64_t> data, const bool is_columnar) : num_pairs_(data.size() / 2) {
+    keys_ = data.data();
+    values_ = is_columnar ? keys_ + num_pairs_ : keys_ + 1;
+    stride_ = is_columnar ? 1 : 2;
+}
+
+size_t LeafPage::LowerBound(const int64_t key, const size_t first) const {
+    if (first >= num_pairs_) {
+        return num_pairs_;
+    }
+
+    // Branchless halving, every key before base is less than key, the answer is in [base, base + length]
+    size_t base = first;
+    size_t length = num_pairs_ - first;
+    const size_t window = stride_ == 1 ? kSimdSearchKeys : 1;
+    while (length > window) {
+        const size_t half = length / 2;
+        base = Key(base + half) < key ? base + half : base;
+        length -= half;
+    }
+
+    // Columnar keys left are compared all at once
+    if (stride_ == 1) {
+        return base + GetSearch().count_less(keys_ + base, length, key);
+    }
+    return base + (Key(base) < key ? 1 : 0);
+}
+
+size_t LeafPage::UpperBound(const int64_t key) const {
+    return key == INT64_MAX ? num_pairs_ : LowerBound(key + 1);
+}
+
+optional<int64_t> LeafPage::Find(const int64_t key) const {
+    const size_t index = LowerBound(key);
+    if (index < num_pairs_ && Key(index) == key) {
+        return Value(index);
+    }
+    return nullopt;
+}
+
+PageData LeafPage::ToColumnar(const span<const int64_t> pairs) {
+    const size_t num_pairs = pairs.size() / 2;
+    PageData columnar(num_pairs * 2);
+    for (size_t i = 0; i < num_pairs; i++) {
+        columnar[i] = pairs[i * 2];
+        columnar[num_pairs + i] = pairs[i * 2 + 1];
+    }
+    return columnar;
+}
+
+const char *LeafPage::SearchName() { return GetSearch().name; }
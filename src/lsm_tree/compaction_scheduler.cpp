@@ -0,0 +1,110 @@
+//
+// Created by Kiiro Huang on 2024-12-06.
+//
+
+#include "../../include/lsm_tree/compaction_scheduler.h"
+
+#include <algorithm>
+
+#include "../../utils/log.h"
+
+CompactionScheduler::CompactionScheduler(LsmTree &lsm_tree, const size_t num_workers, const size_t max_subcompactions) :
+    lsm_tree_(lsm_tree), max_subcompactions_(max_subcompactions) {
+    // At least one worker, or full levels would never be merged
+    for (size_t i = 0; i < max(static_cast<size_t>(1), num_workers); ++i) {
+        workers_.emplace_back(&CompactionScheduler::WorkerLoop, this);
+    }
+}
+
+CompactionScheduler::~CompactionScheduler() { Stop(); }
+
+void CompactionScheduler::Schedule() {
+    // Taking the mutex orders the wake up after a worker that is about to wait
+    { lock_guard lock(mutex_); }
+    cv_.notify_all();
+}
+
+void CompactionScheduler::WaitForLevel0() {
+    unique_lock lock(mutex_);
+
+    // Workers notify after every merge, the flush thread goes on once level 0 is merged
+    cv_.wait(lock, [this] {
+        shared_lock lsm_lock(lsm_tree_.mutex_);
+        return lsm_tree_.levelled_sst_.empty() || lsm_tree_.levelled_sst_[0].size() < kLevel0StopWritesTrigger;
+    });
+}
+
+void CompactionScheduler::Stop() {
+    {
+        lock_guard lock(mutex_);
+        is_stopping_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &worker: workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+}
+
+void CompactionScheduler::WorkerLoop() {
+    unique_lock lock(mutex_);
+    while (true) {
+        optional<int64_t> level;
+
+        // When stopping, a worker exits only once no merge is running, a running merge may fill the next level
+        cv_.wait(lock, [&] {
+            level = PickLevel();
+            return level.has_value() || (is_stopping_ && num_running_ == 0);
+        });
+
+        if (!level.has_value()) {
+            return;
+        }
+
+        LOG(" Compaction worker picks level " << level.value());
+
+        const auto levels = LevelsOf(level.value());
+        busy_levels_.insert(levels.begin(), levels.end());
+        ++num_running_;
+        lock.unlock();
+
+        lsm_tree_.MergeLevel(level.value(), max_subcompactions_);
+
+        lock.lock();
+        for (const auto busy_level: levels) {
+            busy_levels_.erase(busy_level);
+        }
+        --num_running_;
+
+        // The next level may be full now, and waiting workers may be done
+        cv_.notify_all();
+    }
+}
+
+optional<int64_t> CompactionScheduler::PickLevel() const {
+    shared_lock lock(lsm_tree_.mutex_);
+
+    for (int64_t level = 0; level < static_cast<int64_t>(lsm_tree_.levelled_sst_.size()); ++level) {
+        if (!lsm_tree_.NeedsMerge(level)) {
+            continue;
+        }
+
+        const auto levels = LevelsOf(level);
+        if (ranges::none_of(levels, [this](const int64_t l) { return busy_levels_.contains(l); })) {
+            return level;
+        }
+    }
+
+    return nullopt;
+}
+
+vector<int64_t> CompactionScheduler::LevelsOf(const int64_t level) {
+    // The last level is merged in place, its result must stay older than what the level above adds to it
+    if (level + 1 == kLevelToApplyDostoevsky) {
+        return {level, level + 1};
+    }
+    return {level};
+}
@@ -5,9 +5,15 @@
 #include "../../include/lsm_tree/lsm_tree.h"
 
 #include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <queue>
+#include <thread>
 #include <sys/fcntl.h>
+#include <sys/mman.h>
 
 #include "../../include/buffer_pool/buffer_pool_manager.h"
+#include "../../include/readahead.h"
 #include "../../include/sst_counter.h"
 #include "../../utils/log.h"
 
@@ -15,12 +21,12 @@ using namespace std;
 namespace fs = std::filesystem;
 
 
-LsmTree::LsmTree() { BuildLsmTree(); }
+LsmTree::LsmTree() = default;
 
 LsmTree::~LsmTree() {
     for (auto &level: levelled_sst_) {
         for (auto &sst: level) {
-            delete sst;
+            Unref(sst);
         }
         level.clear();
     }
@@ -32,88 +38,125 @@ LsmTree &LsmTree::GetInstance() {
     return instance;
 }
 
-vector<int64_t> LsmTree::SortMerge(vector<BTreeSSTable *> *ssts, bool should_dispose_tombstone) {
+LeafFormat LsmTree::GetLeafFormat(const int64_t level) const {
+    return level < static_cast<int64_t>(leaf_formats_.size()) ? leaf_formats_[level] : LeafFormat::kRaw;
+}
+
+void LsmTree::SortMerge(vector<BTreeSSTable *> *ssts, bool should_dispose_tombstone, BTreeSSTableBuilder *builder,
+                        const int64_t start_key, const int64_t end_key) {
     LOG(" ┌Sort Merge " << (*ssts)[0]->file_path_ << " to " << (*ssts)[ssts->size() - 1]->file_path_);
 
-    vector<int64_t> result;
+    // Last key popped from the heap, older pairs of the same key are dropped
+    optional<int64_t> last_key;
 
     // Use priority_queue as a min-heap
     priority_queue<HeapNode, vector<HeapNode>, greater<>> min_heap;
 
     const size_t n = ssts->size();
-    vector<vector<int64_t>> current_pages(n); // current page data
+    vector<PageHandle> current_pages(n); // current page of each SST, pinned in the buffer pool
+    vector<LeafPage> current_leaves(n); // pairs of the current page of each SST
 
     vector<off_t> offsets(n, 0); // current offset
-    // Read first page of each SSTable to get offset
+    // Find the first leaf of each SSTable to merge through the index
     for (size_t i = 0; i < n; ++i) {
         auto &sst = (*ssts)[i];
-        sst->fd_ = open(sst->file_path_.c_str(), O_RDONLY);
-        auto offset_page = sst->ReadOffset();
-        offsets[i] = offset_page * kPageSize;
+        const auto leaf_index = sst->FindLeaf(start_key);
+        if (!leaf_index.has_value() || sst->min_key_ > end_key) {
+            // No key of the SSTable is in the range
+            offsets[i] = sst->leaf_end_offset_;
+            continue;
+        }
+        offsets[i] = sst->leaf_start_offset_ + leaf_index.value() * kPageSize;
+
+        // Every leaf is read once in order, let the kernel read ahead through mmap
+        sst->Advise(offsets[i], sst->leaf_end_offset_, MADV_SEQUENTIAL);
     }
 
+    // Every leaf of the inputs is read once, through the scan ring, the first leaves are read in one batch
+    vector<pair<const SSTable *, off_t>> first_pages;
+    vector<size_t> first_page_ssts;
     for (size_t i = 0; i < n; ++i) {
-        auto &sst = (*ssts)[i];
-        const auto &page = sst->GetPage(offsets[i]);
-        if (page->GetSize() > 0) {
-            if (!page->data_.empty()) {
-                current_pages[i] = page->data_;
+        if (offsets[i] < (*ssts)[i]->leaf_end_offset_) {
+            first_pages.emplace_back((*ssts)[i], offsets[i]);
+            first_page_ssts.push_back(i);
+        }
+    }
+    auto pages = SSTable::GetPages(first_pages, true);
+
+    for (size_t j = 0; j < pages.size(); ++j) {
+        const size_t i = first_page_ssts[j];
+        auto &page = pages[j];
+        if (page && page.GetSize() > 0) {
+            // Skip the keys before start key in the first leaf
+            const LeafPage leaf = (*ssts)[i]->AsLeaf(page);
+            const size_t page_index = leaf.LowerBound(start_key);
+            if (page_index == leaf.NumPairs()) {
+                continue;
             }
 
-            size_t page_index = 0;
-            const int64_t next_key = page->data_[page_index++];
-            const int64_t next_value = page->data_[page_index++];
-            min_heap.push({next_key, next_value, page_index, i});
+            min_heap.push({leaf.Key(page_index), leaf.Value(page_index), page_index + 1, i});
+
+            current_pages[i] = std::move(page);
+            current_leaves[i] = leaf;
         }
     }
 
+    // The next leaves of each SST are read ahead, up to the leaf holding end key
+    vector<Readahead> readaheads;
+    readaheads.reserve(n);
+    for (const auto sst: *ssts) {
+        readaheads.emplace_back(sst, true, sst->ScanEndOffset(end_key));
+    }
+
     while (!min_heap.empty()) {
         auto [key, value, page_index, sst_id] = min_heap.top();
         min_heap.pop();
 
-        // If largest level, should dispose tombstone
-        if (should_dispose_tombstone && value == INT64_MIN) {
-            continue;
+        // Keys after end key are left to the next sub-range
+        if (key > end_key) {
+            break;
         }
 
-        // Add to the result
         // When key is duplicated, its sst_id would surely be smaller than the previous one
-        if (result.empty() || result[result.size() - 2] != key) {
-            result.push_back(key);
-            result.push_back(value);
+        // If largest level, should dispose tombstone, along with the older pairs it hides
+        if (last_key != key) {
+            last_key = key;
+            if (!should_dispose_tombstone || value != INT64_MIN) {
+                builder->Add(key, value);
+            }
         }
 
         // Update min-heap
         auto &sst = (*ssts)[sst_id];
-        auto &page = current_pages[sst_id];
-        if (page_index + 2 <= page.size()) {
+        const LeafPage &leaf = current_leaves[sst_id];
+        if (page_index < leaf.NumPairs()) {
             // In current page, read next index
-            const int64_t next_key = page[page_index++];
-            const int64_t next_value = page[page_index++];
-            min_heap.push({next_key, next_value, page_index, sst_id});
+            min_heap.push({leaf.Key(page_index), leaf.Value(page_index), page_index + 1, sst_id});
         } else {
             // Read next page
             offsets[sst_id] += kPageSize;
-            if (offsets[sst_id] >= sst->file_size_) {
+            if (offsets[sst_id] >= sst->leaf_end_offset_) {
                 LOG("    Read EOF " << sst->file_path_);
                 continue;
             }
 
-            const auto &next_page = sst->GetPage(offsets[sst_id]);
+            auto next_page = readaheads[sst_id].GetPage(offsets[sst_id]);
 
-            if (next_page) {
-                min_heap.push({next_page->data_[0], next_page->data_[1], 2, sst_id});
+            if (next_page && next_page.GetSize() > 0) {
+                const LeafPage next_leaf = sst->AsLeaf(next_page);
+                min_heap.push({next_leaf.Key(0), next_leaf.Value(0), 1, sst_id});
 
-                // Update newly read page into current_pages
-                current_pages[sst_id] = next_page->data_;
+                // Update newly read page into current_pages, the previous page is unpinned
+                current_pages[sst_id] = std::move(next_page);
+                current_leaves[sst_id] = next_leaf;
             }
         }
     }
-
-    return result;
 }
 
 void LsmTree::AddSst(BTreeSSTable *sst) {
+    unique_lock lock(mutex_);
+
     // Ensure the first level is not empty
     if (levelled_sst_.empty()) {
         levelled_sst_.resize(1);
@@ -122,67 +165,157 @@ void LsmTree::AddSst(BTreeSSTable *sst) {
     levelled_sst_[0].push_back(sst);
 }
 
-// When full in previous level, Sort Merge all the SSTs in this level
-void LsmTree::SortMergePreviousLevel(int64_t current_level) {
-    // If the current level is full
-    if (levelled_sst_[current_level].size() == pow(kLsmRatio, current_level + 1)) {
-        LOG(" Sort Merge Previous Level " << current_level);
-
-        // needs to do the merge
-        const auto result = SortMerge(&levelled_sst_[current_level], false);
+size_t LsmTree::NumRuns(const int64_t level) const {
+    // SSTs of a run are next to each other in the level
+    size_t num_runs = 0;
+    const auto &ssts = levelled_sst_[level];
+    for (size_t i = 0; i < ssts.size(); ++i) {
+        if (i == 0 || ssts[i]->run_ != ssts[i - 1]->run_) {
+            ++num_runs;
+        }
+    }
+    return num_runs;
+}
 
-        for (const auto &node: levelled_sst_[current_level]) {
-            DeleteFile(node);
+bool LsmTree::NeedsMerge(const int64_t level) const {
+    if (level >= static_cast<int64_t>(levelled_sst_.size())) {
+        return false;
+    }
 
-            // Remove the pages from buffer pool
-            BufferPool *buffer_pool = BufferPoolManager::GetInstance();
-            buffer_pool->RemoveLevel(current_level);
-        }
-        levelled_sst_[current_level].clear();
+    // Sort Merge every two runs in the final level
+    if (level == kLevelToApplyDostoevsky) {
+        return NumRuns(level) >= 2;
+    }
 
-        // Current level cleared, set current level counter to 0
-        SSTCounter::GetInstance().SetLevelCounters(current_level, 0);
+    // When full in previous level, Sort Merge the runs in this level
+    return level < static_cast<int64_t>(kLevelToApplyDostoevsky) && NumRuns(level) >= pow(kLsmRatio, level + 1);
+}
 
-        // and then write to the next level
-        if (levelled_sst_.size() == current_level + 1) {
-            levelled_sst_.push_back({});
+vector<int64_t> LsmTree::SplitKeys(const vector<BTreeSSTable *> &ssts, const size_t max_subcompactions) {
+    // The last key of every leaf of every input, each of them ends about the same number of pairs
+    vector<int64_t> leaf_keys;
+    for (const auto &sst: ssts) {
+        for (const auto &internal_node: sst->internal_nodes_) {
+            leaf_keys.insert(leaf_keys.end(), internal_node.begin(), internal_node.end());
         }
+    }
+    ranges::sort(leaf_keys);
 
-        const int64_t next_level = current_level + 1;
+    // Small merges are not worth the threads
+    const size_t num_parts = min(max_subcompactions, leaf_keys.size() / kMinSubcompactionLeaves);
 
-        // Add the result to the next level
-        const string db_name = SSTCounter::GetInstance().GetDbName();
-        const auto new_sst_nodes = new BTreeSSTable(db_name, true, next_level);
+    // Every sub-range takes about the same number of input leaves
+    vector<int64_t> split_keys;
+    for (size_t i = 1; i < num_parts; ++i) {
+        const int64_t key = leaf_keys[leaf_keys.size() * i / num_parts];
+        if (key != INT64_MAX && (split_keys.empty() || split_keys.back() != key)) {
+            split_keys.push_back(key);
+        }
+    }
+    return split_keys;
+}
 
-        // Generate a new SST in storage
-        string file_path = new_sst_nodes->FlushToStorage(&result);
+size_t LsmTree::MaxPairs(const vector<BTreeSSTable *> &ssts, const int64_t start_key, const int64_t end_key) {
+    // Every leaf that may hold a key of [start_key, end_key] counts as full, an SST holds at most its pairs
+    size_t max_pairs = 0;
+    for (const auto &sst: ssts) {
+        const auto first_leaf = sst->FindLeaf(start_key);
+        if (!first_leaf.has_value() || sst->min_key_ > end_key) {
+            continue;
+        }
 
-        levelled_sst_[next_level].push_back(new_sst_nodes);
+        const size_t num_leaves = (sst->leaf_end_offset_ - sst->leaf_start_offset_ + kPageSize - 1) / kPageSize;
+        const size_t last_leaf = sst->FindLeaf(end_key).value_or(num_leaves - 1);
+        max_pairs += min(sst->num_pairs_, (last_leaf - first_leaf.value() + 1) * sst->MaxLeafPairs());
     }
+    return max_pairs;
 }
 
-// Sort Merge every two SSTs in the final level
-void LsmTree::SortMergeLastLevel() {
-    auto last_level_nodes = levelled_sst_[kLevelToApplyDostoevsky];
-    if (last_level_nodes.size() >= 2) {
-        const auto result = SortMerge(&last_level_nodes, true);
+void LsmTree::MergeLevel(const int64_t level, const size_t max_subcompactions) {
+    const bool is_last_level = level == kLevelToApplyDostoevsky;
+    const int64_t next_level = is_last_level ? level : level + 1;
+
+    // The SSTs of the oldest runs of the level, the flush thread or other merges only append newer SSTs meanwhile
+    vector<BTreeSSTable *> inputs;
+    {
+        shared_lock lock(mutex_);
+        const size_t num_runs = is_last_level ? NumRuns(level) : static_cast<size_t>(pow(kLsmRatio, level + 1));
+        size_t num_input_runs = 0;
+        for (const auto &sst: levelled_sst_[level]) {
+            if (inputs.empty() || sst->run_ != inputs.back()->run_) {
+                if (num_input_runs++ == num_runs) {
+                    break;
+                }
+            }
+            inputs.push_back(sst);
+        }
+    }
+    LOG(" Sort Merge Level " << level << " into level " << next_level);
+
+    // Split the key range into sub-ranges merged concurrently, one SST each
+    // Sub-range i takes the keys in (split_keys[i - 1], split_keys[i]]
+    const auto split_keys = SplitKeys(inputs, max_subcompactions);
+    const size_t num_parts = split_keys.size() + 1;
+
+    const string db_name = SSTCounter::GetInstance().GetDbName();
+    const int64_t run = SSTCounter::GetInstance().GenerateIndex(next_level);
+    vector<BTreeSSTable *> outputs(num_parts, nullptr);
 
-        for (const auto &node: levelled_sst_[kLevelToApplyDostoevsky]) {
-            DeleteFile(node);
+    auto merge_part = [&](const size_t part) {
+        const int64_t start_key = part == 0 ? INT64_MIN : split_keys[part - 1] + 1;
+        const int64_t end_key = part == num_parts - 1 ? INT64_MAX : split_keys[part];
 
-            // Remove the pages from buffer pool
-            BufferPool *buffer_pool = BufferPoolManager::GetInstance();
-            buffer_pool->RemoveLevel(kLevelToApplyDostoevsky);
+        // Generate a new SST in storage, leaf pages are written as the merge goes
+        const auto new_sst_nodes = new BTreeSSTable(db_name, next_level, run,
+                                                    num_parts == 1 ? nullopt : optional(part));
+        // The pages written are not cached, they would push the pages of point lookups out of the buffer pool
+        BTreeSSTableBuilder builder(new_sst_nodes, MaxPairs(inputs, start_key, end_key), false,
+                                    GetLeafFormat(next_level));
+
+        // If largest level, should dispose tombstone
+        SortMerge(&inputs, is_last_level, &builder, start_key, end_key);
+        builder.Finish();
+
+        // Every pair was a tombstone or hidden by one, nothing is left to keep
+        if (builder.NumPairs() == 0) {
+            BufferPoolManager::GetInstance()->RemoveSst(new_sst_nodes->file_id_);
+            DeleteFile(new_sst_nodes);
+            return;
         }
-        levelled_sst_[kLevelToApplyDostoevsky].clear();
+        outputs[part] = new_sst_nodes;
+    };
+
+    vector<thread> threads;
+    for (size_t part = 1; part < num_parts; ++part) {
+        threads.emplace_back(merge_part, part);
+    }
+    merge_part(0);
+    for (auto &t: threads) {
+        t.join();
+    }
 
-        // Name of SST should always be BTree_lastlevel_0.bin
-        const string db_name = SSTCounter::GetInstance().GetDbName();
-        const auto new_sst_nodes = new BTreeSSTable(db_name, true, kLevelToApplyDostoevsky);
-        levelled_sst_[kLevelToApplyDostoevsky].push_back(new_sst_nodes);
+    // Swap the merged SSTs for the new ones, once no read is using them
+    unique_lock lock(mutex_);
 
-        // Generate a new SST in storage
-        string file_path = new_sst_nodes->FlushToStorage(&result);
+    auto &ssts = levelled_sst_[level];
+    ssts.erase(ssts.begin(), ssts.begin() + inputs.size());
+
+    // Iterators may still read the inputs, their pages and files are removed with the last reference
+    for (const auto &node: inputs) {
+        node->is_obsolete_ = true;
+        Unref(node);
+    }
+
+    if (static_cast<int64_t>(levelled_sst_.size()) == next_level) {
+        levelled_sst_.push_back({});
+    }
+
+    // Data of the next level is older than any data of this level, the result is the newest run there
+    // The last level is not merged while the level above merges into it, so it only held the inputs
+    for (const auto &output: outputs) {
+        if (output) {
+            levelled_sst_[next_level].push_back(output);
+        }
     }
 }
 
@@ -193,7 +326,8 @@ vector<vector<BTreeSSTable *>> LsmTree::ReadSSTsFromStorage() {
     auto &sst_counter = SSTCounter::GetInstance();
     const string db_name = sst_counter.GetDbName();
 
-    const regex filename_pattern(R"(btree(\d+)_(\d+)\.bin)");
+    // The parts of a merge split into key sub-ranges are named btree<level>_<index>-<part>.bin
+    const regex filename_pattern(R"(btree(\d+)_(\d+)(-\d+)?\.bin)");
 
     for (const auto &entry: fs::directory_iterator(db_name)) {
         string filename = entry.path().filename().string();
@@ -210,6 +344,7 @@ vector<vector<BTreeSSTable *>> LsmTree::ReadSSTsFromStorage() {
             }
 
             auto sst = new BTreeSSTable(db_name + "/" + filename, false);
+            sst->run_ = index;
             levels[level].push_back(sst);
 
             level_counters[level] = max(level_counters[level], index + 1);
@@ -217,9 +352,12 @@ vector<vector<BTreeSSTable *>> LsmTree::ReadSSTsFromStorage() {
         }
     }
 
-    // Sort the SSTs in each level, the oldest SST comes first
+    // Sort the SSTs in each level, the oldest run comes first, the parts of a run in key order
+    // Files are numbered in creation order, btree1_10 is newer than btree1_9
     for (auto &level: levels) {
-        ranges::sort(level, [](const BTreeSSTable *a, const BTreeSSTable *b) { return a->file_path_ < b->file_path_; });
+        ranges::sort(level, [](const BTreeSSTable *a, const BTreeSSTable *b) {
+            return a->run_ != b->run_ ? a->run_ < b->run_ : a->min_key_ < b->min_key_;
+        });
     }
 
     return levels;
@@ -227,21 +365,31 @@ vector<vector<BTreeSSTable *>> LsmTree::ReadSSTsFromStorage() {
 
 // Build LSM-Tree from storage
 void LsmTree::BuildLsmTree() {
+    unique_lock lock(mutex_);
+
+    // Release the SSTs of the previously opened database, their files stay on storage
+    for (auto &level: levelled_sst_) {
+        for (const auto &sst: level) {
+            Unref(sst);
+        }
+    }
+
     // Read all the SSTs from the storage
     levelled_sst_ = ReadSSTsFromStorage();
-
-    // Do necessary sort merge
-    OrderLsmTree();
 }
 
-void LsmTree::OrderLsmTree() {
-    for (int64_t current_level = 0; current_level < min(levelled_sst_.size(), kLevelToApplyDostoevsky);
-         current_level++) {
-        SortMergePreviousLevel(current_level);
+void LsmTree::Unref(BTreeSSTable *sst) {
+    // The last release sees is_obsolete_, set before the release of the LSM-Tree
+    if (sst->num_refs_.fetch_sub(1, memory_order_acq_rel) != 1) {
+        return;
     }
 
-    if (kLevelToApplyDostoevsky == levelled_sst_.size() - 1) {
-        SortMergeLastLevel();
+    if (sst->is_obsolete_) {
+        // Remove the pages from buffer pool
+        BufferPoolManager::GetInstance()->RemoveSst(sst->file_id_);
+        DeleteFile(sst);
+    } else {
+        delete sst;
     }
 }
 
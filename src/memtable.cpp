@@ -4,25 +4,40 @@
 
 #include "../include/memtable.h"
 
+#include <mutex>
+
 using namespace std;
 
-void Memtable::Put(const int64_t key, const int64_t value) { table_[key] = value; }
+void Memtable::Put(const int64_t key, const int64_t value) {
+    unique_lock lock(mutex_);
+    ++last_sequence_;
+
+    // No iterator sees the newest version of the key, it is overwritten instead of kept
+    const auto newest = table_.lower_bound({key, UINT64_MAX});
+    if (newest != table_.end() && newest->first.first == key && newest->first.second > snapshot_sequence_) {
+        newest->second = value;
+        return;
+    }
+    table_.emplace_hint(newest, make_pair(key, last_sequence_), value);
+}
 
 optional<int64_t> Memtable::Get(const int64_t key) const {
-    const auto it = table_.find(key);
-    if (it != table_.end()) {
+    shared_lock lock(mutex_);
+    const auto it = table_.lower_bound({key, UINT64_MAX});
+    if (it != table_.end() && it->first.first == key) {
         return it->second;
     }
     return nullopt;
 }
 
 vector<pair<int64_t, int64_t>> Memtable::Scan(const int64_t startKey, const int64_t endKey) const {
+    shared_lock lock(mutex_);
     vector<pair<int64_t, int64_t>> result;
-    const auto start_it = table_.lower_bound(startKey);
-    const auto end_it = table_.upper_bound(endKey);
-
-    for (auto it = start_it; it != end_it; ++it) {
-        result.emplace_back(it->first, it->second);
+    for (auto it = table_.lower_bound({startKey, UINT64_MAX}); it != table_.end() && it->first.first <= endKey; ++it) {
+        // The first version of every key is the newest
+        if (result.empty() || result.back().first != it->first.first) {
+            result.emplace_back(it->first.first, it->second);
+        }
     }
     return result;
 }
@@ -30,15 +45,59 @@ vector<pair<int64_t, int64_t>> Memtable::Scan(const int64_t startKey, const int6
 void Memtable::Delete(const int64_t key) { Put(key, INT64_MIN); }
 
 vector<int64_t> Memtable::Traverse() const {
+    shared_lock lock(mutex_);
     vector<int64_t> result;
 
-    for (const auto &[fst, snd]: table_) {
-        result.push_back(fst);
-        result.push_back(snd);
+    for (const auto &[version, value]: table_) {
+        if (result.empty() || result[result.size() - 2] != version.first) {
+            result.push_back(version.first);
+            result.push_back(value);
+        }
     }
     return result;
 }
 
-void Memtable::clear() { table_.clear(); }
+void Memtable::clear() {
+    unique_lock lock(mutex_);
+    table_.clear();
+}
+
+size_t Memtable::Size() const {
+    shared_lock lock(mutex_);
+    return table_.size() * sizeof(int64_t) * 2;
+}
+
+Iterator *Memtable::NewIterator() const {
+    // The versions the iterator sees are kept from now on
+    unique_lock lock(mutex_);
+    snapshot_sequence_ = last_sequence_;
+    return new MemtableIterator(this, last_sequence_);
+}
+
+void MemtableIterator::Seek(const int64_t key) {
+    shared_lock lock(memtable_->mutex_);
+    it_ = memtable_->table_.lower_bound({key, UINT64_MAX});
+    SkipNewerVersions();
+}
+
+void MemtableIterator::Next() {
+    shared_lock lock(memtable_->mutex_);
+
+    // Older versions of the current key are hidden by the one at the cursor
+    while (it_ != memtable_->table_.end() && it_->first.first == key_) {
+        ++it_;
+    }
+    SkipNewerVersions();
+}
+
+void MemtableIterator::SkipNewerVersions() {
+    while (it_ != memtable_->table_.end() && it_->first.second > sequence_) {
+        ++it_;
+    }
 
-size_t Memtable::Size() const { return table_.size() * sizeof(int64_t) * 2; }
+    is_valid_ = it_ != memtable_->table_.end();
+    if (is_valid_) {
+        key_ = it_->first.first;
+        value_ = it_->second;
+    }
+}
@@ -0,0 +1,41 @@
+//
+// Created by Kiiro Huang on 2024-12-05.
+//
+
+#include "../include/merging_iterator.h"
+
+MergingIterator::MergingIterator(vector<Iterator *> children) : children_(std::move(children)) {}
+
+MergingIterator::~MergingIterator() {
+    for (const auto child: children_) {
+        delete child;
+    }
+}
+
+void MergingIterator::Seek(const int64_t key) {
+    min_heap_ = {};
+
+    for (size_t i = 0; i < children_.size(); ++i) {
+        children_[i]->Seek(key);
+        PushChild(i);
+    }
+}
+
+void MergingIterator::Next() {
+    const int64_t key = Key();
+
+    // Every child positioned at the current key moves on, so each key is yielded once
+    while (!min_heap_.empty() && min_heap_.top().key == key) {
+        const size_t child_id = min_heap_.top().child_id;
+        min_heap_.pop();
+
+        children_[child_id]->Next();
+        PushChild(child_id);
+    }
+}
+
+void MergingIterator::PushChild(const size_t child_id) {
+    if (children_[child_id]->Valid()) {
+        min_heap_.push({children_[child_id]->Key(), child_id});
+    }
+}
@@ -0,0 +1,42 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#include "../include/readahead.h"
+
+#include <algorithm>
+
+#include "../utils/constants.h"
+
+Readahead::Readahead(const SSTable *sst, const bool is_sequential_flooding, const off_t end_offset) :
+    sst_(sst), is_sequential_flooding_(is_sequential_flooding), end_offset_(end_offset) {}
+
+PageHandle Readahead::GetPage(const off_t offset) {
+    const off_t aligned_offset = offset - offset % kPageSize;
+
+    // Out of order, what was read ahead is not what the cursor needs
+    if (aligned_offset != next_offset_) {
+        pages_.clear();
+        window_pages_ = 0;
+    }
+
+    if (pages_.empty()) {
+        window_pages_ = window_pages_ == 0 ? kReadaheadMinPages : min(window_pages_ * 2, kReadaheadMaxPages);
+
+        // The page asked for is read even past the end
+        const off_t pages_to_end = (end_offset_ - aligned_offset + static_cast<off_t>(kPageSize) - 1) / kPageSize;
+        const size_t num_pages = clamp(pages_to_end, static_cast<off_t>(1), static_cast<off_t>(window_pages_));
+        for (auto &page: sst_->ReadPages(aligned_offset, num_pages, is_sequential_flooding_)) {
+            pages_.push_back(std::move(page));
+        }
+    }
+
+    next_offset_ = aligned_offset + kPageSize;
+    if (pages_.empty()) {
+        return {};
+    }
+
+    PageHandle page = std::move(pages_.front());
+    pages_.pop_front();
+    return page;
+}
@@ -15,24 +15,37 @@ SSTCounter &SSTCounter::GetInstance() {
     return instance;
 }
 
-string SSTCounter::GetDbName() const { return db_name_; }
+string SSTCounter::GetDbName() const {
+    lock_guard lock(mutex_);
+    return db_name_;
+}
 
 void SSTCounter::SetDbName(const string &db_name) {
+    lock_guard lock(mutex_);
     db_name_ = db_name;
     level_counters_.clear();
 }
 
 void SSTCounter::SetLevelCounters(int64_t level, int64_t counter) {
+    lock_guard lock(mutex_);
     if (level >= level_counters_.size()) {
         level_counters_.resize(level + 1, 0);
     }
     level_counters_[level] = counter;
 }
 
-string SSTCounter::GenerateFileName(const int64_t level) {
+int64_t SSTCounter::GenerateIndex(const int64_t level) {
+    lock_guard lock(mutex_);
     if (level >= level_counters_.size()) {
         level_counters_.resize(level + 1, 0);
     }
-    const int64_t index = level_counters_[level]++;
-    return "btree" + to_string(level) + "_" + to_string(index) + ".bin";
+    return level_counters_[level]++;
+}
+
+string SSTCounter::FileName(const int64_t level, const int64_t index, const optional<size_t> part) {
+    string file_name = "btree" + to_string(level) + "_" + to_string(index);
+    if (part.has_value()) {
+        file_name += "-" + to_string(part.value());
+    }
+    return file_name + ".bin";
 }
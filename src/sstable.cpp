@@ -4,12 +4,22 @@
 
 #include "../include/sstable.h"
 
+#include <climits>
+#include <cstring>
 #include <iostream>
+#include <ranges>
 #include <sys/fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <unordered_map>
 
+#include "../include/async_reader.h"
+#include "../include/bit_packed_leaf.h"
 #include "../include/buffer_pool/buffer_pool_manager.h"
 #include "../include/buffer_pool/page.h"
+#include "../include/readahead.h"
+#include "../include/table_cache.h"
 #include "../utils/constants.h"
 #include "../utils/log.h"
 
@@ -17,41 +27,85 @@
 using namespace std;
 
 SSTable::~SSTable() {
+    if (const char *mapped = mapped_data_.load()) {
+        munmap(const_cast<char *>(mapped), file_size_);
+        mapped_data_ = nullptr;
+    }
+
+    // The table cache may be closing this file on another thread
+    lock_guard lock(file_mutex_);
     if (fd_ >= 0) {
-        close(fd_);
+        TableCache::GetInstance().Erase(this);
+        CloseFds();
         LOG("  Closed file: " << file_path_ << " passively");
-        fd_ = -1;
     }
 }
 
+string SSTable::Name() const {
+    const size_t start_pos = file_path_.find('/') + 1;
+    const size_t end_pos = file_path_.rfind(".bin");
+    return file_path_.substr(start_pos, end_pos - start_pos);
+}
+
 int SSTable::EnsureFileOpen() const {
     if (fd_ == -1) {
         fd_ = open(file_path_.c_str(), O_RDWR);
         if (fd_ < 0) {
             throw std::runtime_error("Failed to open SSTable file: " + file_path_);
         }
-    } else {
-        if (fcntl(fd_, F_GETFD) == -1) {
-            close(fd_);
-            fd_ = open(file_path_.c_str(), O_RDWR);
-            if (fd_ < 0) {
-                throw std::runtime_error("Failed to reopen SSTable file: " + file_path_);
-            }
-        }
     }
+
+    // Keep the file open for the next reads, the least recently used SSTs get closed instead
+    TableCache::GetInstance().Touch(this);
     return fd_;
 }
 
 void SSTable::CloseFile() const {
+    lock_guard lock(file_mutex_);
     if (fd_ >= 0) {
-        close(fd_);
+        TableCache::GetInstance().Erase(this);
+        CloseFds();
         LOG("  Closed file: " << file_path_ << " actively");
-        fd_ = -1;
     }
 }
 
+void SSTable::CloseFds() const {
+    close(fd_);
+    fd_ = -1;
+    if (direct_fd_ >= 0) {
+        close(direct_fd_);
+        direct_fd_ = -1;
+    }
+}
+
+int SSTable::EnsureDirectFileOpen() const {
+    // The table cache counts the SST once, fd_ is opened and touched first and both fds are closed together
+    EnsureFileOpen();
+    if (direct_fd_ == -1) {
+#ifdef __APPLE__
+        direct_fd_ = open(file_path_.c_str(), O_RDWR);
+        if (direct_fd_ >= 0) {
+            fcntl(direct_fd_, F_NOCACHE, 1);
+        }
+#else
+        direct_fd_ = open(file_path_.c_str(), O_RDWR | O_DIRECT);
+
+        // Some file systems, like tmpfs, have no direct I/O, pages go through the page cache there
+        if (direct_fd_ < 0 && errno == EINVAL) {
+            LOG("  No direct I/O for " << file_path_ << ", reading it through the page cache");
+            direct_fd_ = open(file_path_.c_str(), O_RDWR);
+        }
+#endif
+        if (direct_fd_ < 0) {
+            throw std::runtime_error("Failed to open SSTable file for direct I/O: " + file_path_);
+        }
+    }
+    return direct_fd_;
+}
+
 off_t SSTable::GetFileSize() const {
-    const off_t file_size = lseek(fd_, 0, SEEK_END);
+    lock_guard lock(file_mutex_);
+    const off_t file_size = lseek(EnsureFileOpen(), 0, SEEK_END);
     if (file_size == -1) {
         cerr << "  Failed to determine file size: " << strerror(errno) << endl;
         return -1;
@@ -59,12 +113,102 @@ off_t SSTable::GetFileSize() const {
     return file_size;
 }
 
+const char *SSTable::EnsureMapped() const {
+    if (const char *mapped = mapped_data_.load(memory_order_acquire)) {
+        return mapped;
+    }
+    if (TableCache::GetInstance().GetReadMode() != ReadMode::kMmap || file_size_ <= 0) {
+        return nullptr;
+    }
+
+    lock_guard lock(file_mutex_);
+
+    // Another thread may have mapped the file meanwhile
+    if (const char *mapped = mapped_data_.load(memory_order_acquire)) {
+        return mapped;
+    }
+
+    // The mapping outlives the fd, so the table cache may close the file afterwards
+    void *mapped = mmap(nullptr, file_size_, PROT_READ, MAP_SHARED, EnsureFileOpen(), 0);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Failed to map SSTable file: " + file_path_);
+    }
+    LOG("  Mapped file: " << file_path_);
+
+    // Point lookups are the common case, do not read ahead by default
+    madvise(mapped, file_size_, MADV_RANDOM);
+
+    mapped_data_.store(static_cast<const char *>(mapped), memory_order_release);
+    return static_cast<const char *>(mapped);
+}
+
+void SSTable::Advise(const off_t begin, const off_t end, const int advice) const {
+    const char *mapped = EnsureMapped();
+    if (!mapped || begin < 0 || begin >= end) {
+        return;
+    }
+
+    // madvise needs a page aligned start
+    const off_t aligned_begin = begin - begin % kPageSize;
+    const off_t aligned_end = min(end, file_size_);
+    madvise(const_cast<char *>(mapped) + aligned_begin, aligned_end - aligned_begin, advice);
+}
+
+ssize_t SSTable::ReadBytes(void *buffer, const size_t size, const off_t offset) const {
+    if (const char *mapped = EnsureMapped()) {
+        if (offset < 0 || offset >= file_size_) {
+            return 0;
+        }
+        const size_t bytes = min(size, static_cast<size_t>(file_size_ - offset));
+        memcpy(buffer, mapped + offset, bytes);
+        return bytes;
+    }
+
+    lock_guard lock(file_mutex_);
+    return pread(EnsureFileOpen(), buffer, size, offset);
+}
+
+void SSTable::WriteBytes(const void *buffer, const size_t size, const off_t offset) const {
+    lock_guard lock(file_mutex_);
+    if (pwrite(EnsureFileOpen(), buffer, size, offset) < 0) {
+        cerr << "Failed to write " << size << " bytes at offset " << offset << " of " << file_path_ << endl;
+        exit(1);
+    }
+}
+
+ssize_t SSTable::ReadDirect(void *buffer, const size_t size, const off_t offset) const {
+    lock_guard lock(file_mutex_);
+    return pread(EnsureDirectFileOpen(), buffer, size, offset);
+}
+
+void SSTable::WriteDirect(const void *buffer, const size_t size, const off_t offset) const {
+    lock_guard lock(file_mutex_);
+    if (pwrite(EnsureDirectFileOpen(), buffer, size, offset) < 0) {
+        cerr << "Failed to write " << size << " bytes at offset " << offset << " of " << file_path_
+             << " with direct I/O: " << strerror(errno) << endl;
+        exit(1);
+    }
+}
+
+void SSTable::SyncFile() const {
+    lock_guard lock(file_mutex_);
+#ifdef __APPLE__
+    const int result = fsync(EnsureFileOpen());
+#else
+    const int result = fdatasync(EnsureFileOpen());
+#endif
+    if (result < 0) {
+        cerr << "Failed to sync " << file_path_ << endl;
+        exit(1);
+    }
+}
+
 // Update min key and max key of the SSTable
 void SSTable::InitialKeyRange() {
     char buffer[kPageSize];
 
     // Read the first block to get the minimum key
-    ssize_t bytes_read = pread(fd_, buffer, kPageSize, 0);
+    ssize_t bytes_read = ReadBytes(buffer, kPageSize, 0);
     if (bytes_read > 0) {
         size_t pos = 0;
         pair<int64_t, int64_t> first_entry;
@@ -75,7 +219,7 @@ void SSTable::InitialKeyRange() {
 
     // Read the last block to get the maximum key
     const off_t last_block_offset = file_size_ > kPageSize ? file_size_ - kPageSize : 0;
-    bytes_read = pread(fd_, buffer, kPageSize, last_block_offset);
+    bytes_read = ReadBytes(buffer, kPageSize, last_block_offset);
     if (bytes_read > 0) {
         size_t pos = 0;
         pair<int64_t, int64_t> last_entry;
@@ -104,55 +248,231 @@ bool SSTable::ReadEntry(const char *buffer, const size_t buffer_size, size_t &po
     return true;
 }
 
-Page *SSTable::GetPage(const off_t offset, const bool is_sequential_flooding) const {
-    // Concatenate the name of the file with the offset to get the page id
-    const size_t start_pos = file_path_.find('/') + 1;
-    const size_t end_pos = file_path_.rfind(".bin");
-    const string sst_name = file_path_.substr(start_pos, end_pos - start_pos);
+PageHandle SSTable::GetPage(const off_t offset, const bool is_sequential_flooding) const {
+    // Align the offset to the beginning of the page
+    const off_t aligned_offset = offset - (offset % kPageSize);
+
+    size_t read_size = 0;
+    if (PageHandle page = FindPage(aligned_offset, is_sequential_flooding, read_size); page || read_size == 0) {
+        return page;
+    }
+
+    // If the page is not in the buffer pool, read it from disk
+    // Key-value pairs are stored as raw int64_t, read them straight into the page data
+    PageData data = NewPageData(read_size, is_sequential_flooding);
+    const ssize_t bytes_read = IsDirectIO() ? ReadDirect(data.data(), data.size() * sizeof(int64_t), aligned_offset)
+                                            : ReadBytes(data.data(), data.size() * sizeof(int64_t), aligned_offset);
+    return CachePage(aligned_offset, std::move(data), bytes_read, read_size, is_sequential_flooding);
+}
 
-    const string page_id = sst_name + "_" + to_string(offset);
+vector<PageHandle> SSTable::GetPages(const span<const pair<const SSTable *, off_t>> pages,
+                                     const bool is_sequential_flooding) {
+    vector<PageHandle> handles(pages.size());
+
+    // Pages to read, with their indexes in pages
+    vector<size_t> misses;
+    vector<size_t> read_sizes(pages.size());
+    for (size_t i = 0; i < pages.size(); i++) {
+        const auto [sst, offset] = pages[i];
+        handles[i] = sst->FindPage(offset - offset % kPageSize, is_sequential_flooding, read_sizes[i]);
+        if (!handles[i] && read_sizes[i] > 0) {
+            misses.push_back(i);
+        }
+    }
+
+    // A single page gains nothing from a batch
+    if (misses.size() == 1) {
+        handles[misses[0]] = pages[misses[0]].first->GetPage(pages[misses[0]].second, is_sequential_flooding);
+        return handles;
+    }
+    if (misses.empty()) {
+        return handles;
+    }
+
+    // The reads go through duplicates of the descriptors, the table cache may close the SSTs while they are in flight
+    const bool is_direct_io = IsDirectIO();
+    unordered_map<const SSTable *, int> fds;
+    for (const size_t i: misses) {
+        const SSTable *sst = pages[i].first;
+        if (!fds.contains(sst)) {
+            lock_guard lock(sst->file_mutex_);
+            fds[sst] = dup(is_direct_io ? sst->EnsureDirectFileOpen() : sst->EnsureFileOpen());
+        }
+    }
+
+    vector<PageData> datas;
+    vector<ReadRequest> requests;
+    datas.reserve(misses.size());
+    requests.reserve(misses.size());
+    for (const size_t i: misses) {
+        const auto [sst, offset] = pages[i];
+        const off_t aligned_offset = offset - offset % kPageSize;
+        PageData &data = datas.emplace_back(NewPageData(read_sizes[i], is_sequential_flooding));
+        requests.push_back({fds[sst], data.data(), data.size() * sizeof(int64_t), aligned_offset});
+    }
+    AsyncReader::GetInstance().ReadAll(requests);
+
+    for (const auto fd: fds | views::values) {
+        close(fd);
+    }
+
+    for (size_t j = 0; j < misses.size(); j++) {
+        const size_t i = misses[j];
+        const auto [sst, offset] = pages[i];
+        if (requests[j].result < 0) {
+            errno = static_cast<int>(-requests[j].result);
+        }
+        handles[i] = sst->CachePage(offset - offset % kPageSize, std::move(datas[j]), requests[j].result,
+                                    read_sizes[i], is_sequential_flooding);
+    }
+    return handles;
+}
+
+vector<PageHandle> SSTable::ReadPages(const off_t offset, const size_t num_pages,
+                                     const bool is_sequential_flooding) const {
+    const off_t aligned_offset = offset - offset % kPageSize;
+
+    vector<PageHandle> handles;
+    vector<size_t> read_sizes;
+    for (size_t i = 0; i < num_pages; i++) {
+        size_t read_size = 0;
+        PageHandle page = FindPage(aligned_offset + i * kPageSize, is_sequential_flooding, read_size);
+        if (!page && read_size == 0) {
+            break;
+        }
+        handles.push_back(std::move(page));
+        read_sizes.push_back(read_size);
+    }
+
+    const bool is_direct_io = IsDirectIO();
+    size_t begin = 0;
+    while (begin < handles.size()) {
+        if (handles[begin]) {
+            ++begin;
+            continue;
+        }
+
+        // Pages [begin, end) are not cached and follow each other in the file
+        size_t end = begin + 1;
+        while (end < handles.size() && !handles[end] && end - begin < IOV_MAX) {
+            ++end;
+        }
+
+        vector<PageData> datas;
+        vector<iovec> iovecs;
+        for (size_t i = begin; i < end; i++) {
+            PageData &data = datas.emplace_back(NewPageData(read_sizes[i], is_sequential_flooding));
+            iovecs.push_back({data.data(), data.size() * sizeof(int64_t)});
+        }
+
+        const off_t run_offset = aligned_offset + begin * kPageSize;
+        ssize_t bytes_left;
+        {
+            lock_guard lock(file_mutex_);
+            const int fd = is_direct_io ? EnsureDirectFileOpen() : EnsureFileOpen();
+            bytes_left = preadv(fd, iovecs.data(), static_cast<int>(iovecs.size()), run_offset);
+        }
+
+        // The bytes read fill the pages in order, a short read leaves the last ones empty
+        for (size_t i = begin; i < end; i++) {
+            const ssize_t bytes_read = min(bytes_left, static_cast<ssize_t>(iovecs[i - begin].iov_len));
+            handles[i] = CachePage(aligned_offset + i * kPageSize, std::move(datas[i - begin]), bytes_read,
+                                   read_sizes[i], is_sequential_flooding);
+            bytes_left -= max(bytes_read, static_cast<ssize_t>(0));
+        }
+        begin = end;
+    }
+    return handles;
+}
+
+PageHandle SSTable::FindPage(const off_t aligned_offset, const bool is_sequential_flooding, size_t &read_size) const {
+    // The last page may be partial, do not read what follows the key-value pairs
+    const off_t data_end_offset = DataEndOffset();
+    if (aligned_offset >= data_end_offset) {
+        read_size = 0;
+        return {};
+    }
+    read_size = min(static_cast<off_t>(kPageSize), data_end_offset - aligned_offset);
+
+    // Through mmap, a raw or columnar page is a view of the mapping, nothing is read, copied or cached here
+    // Bit-packed pages are read from the mapping, decoded and cached like any other read
+    if (const char *mapped = EnsureMapped(); mapped && leaf_format_ != LeafFormat::kBitPacked) {
+        const auto data = reinterpret_cast<const int64_t *>(mapped + aligned_offset);
+        return PageHandle(span(data, read_size / kPairSize * 2));
+    }
+
+    const PageId page_id = GetPageId(aligned_offset);
 
     const auto buffer_pool = BufferPoolManager::GetInstance();
-    Page *exist_page = buffer_pool->Get(page_id);
-    if (exist_page != nullptr) {
+    PageHandle exist_page = buffer_pool->Get(page_id);
+    if (exist_page) {
         return exist_page;
     }
 
-    // If the page is not in the buffer pool, read it from disk
-    char buffer[kPageSize] = {};
+    // If sequential flooding, the page is read through the scan ring and never put into the shards
+    if (is_sequential_flooding) {
+        if (PageHandle ring_page = buffer_pool->scan_ring_.Get(page_id)) {
+            return ring_page;
+        }
+    }
+    return {};
+}
 
-    // Align the offset to the beginning of the page
-    const off_t aligned_offset = offset - (offset % kPageSize);
+PageData SSTable::NewPageData(const size_t read_size, const bool is_sequential_flooding) {
+    // With direct I/O the whole page is read, what follows the key-value pairs is dropped after
+    const size_t num_values = (IsDirectIO() ? kPageSize : read_size) / sizeof(int64_t);
+    return is_sequential_flooding ? BufferPoolManager::GetInstance()->scan_ring_.TakeBuffer(num_values)
+                                  : PageData(num_values);
+}
 
-    ssize_t bytes_read = pread(fd_, buffer, kPageSize, aligned_offset);
+PageHandle SSTable::CachePage(const off_t aligned_offset, PageData data, const ssize_t bytes_read,
+                              const size_t read_size, const bool is_sequential_flooding) const {
     if (bytes_read <= 0) {
-        LOG("\tCould not read page at offset " << offset << " in " << file_path_ << ": " << strerror(errno));
-        return nullptr;
+        LOG("\tCould not read page at offset " << aligned_offset << " in " << file_path_ << ": " << strerror(errno));
+        return {};
     }
-
-    vector<int64_t> data;
-    size_t pos = 0;
-    pair<int64_t, int64_t> entry;
-    while (ReadEntry(buffer, static_cast<size_t>(bytes_read), pos, entry)) {
-        data.push_back(entry.first);
-        data.push_back(entry.second);
+    data.resize(min(static_cast<size_t>(bytes_read), read_size) / sizeof(int64_t));
+    if (leaf_format_ == LeafFormat::kBitPacked) {
+        PageData pairs;
+        if (!BitPackedLeaf::Decode(data, pairs)) {
+            LOG("\tCould not decode page at offset " << aligned_offset << " in " << file_path_);
+            return {};
+        }
+        data = std::move(pairs);
+    } else {
+        data.resize(data.size() / 2 * 2);
     }
 
-    // If not sequential flooding, put the page into the buffer pool
-    if (!is_sequential_flooding) {
-        auto buffer_pool = BufferPoolManager::GetInstance();
-        buffer_pool->Put(page_id, data);
+    const PageId page_id = GetPageId(aligned_offset);
+    const auto buffer_pool = BufferPoolManager::GetInstance();
+    if (is_sequential_flooding) {
+        return buffer_pool->scan_ring_.Put(page_id, std::move(data));
     }
 
-    auto new_page = new Page(page_id, data);
-    return new_page;
+    return buffer_pool->Put(page_id, std::move(data));
 }
 
-optional<int64_t> SSTable::Get(const int64_t key) const {
+bool SSTable::IsDirectIO() { return TableCache::GetInstance().GetReadMode() == ReadMode::kDirectIO; }
+
+bool SSTable::MayContain(const int64_t key) const {
     // If max key is smaller than key, no need to scan
     // If min key is larger than key, no need to scan
     if (max_key_ < key || min_key_ > key) {
         LOG("\t\tno value in this sst");
+        return false;
+    }
+
+    // Bloom filter tells the key is surely not in this SST, no page needs to be read
+    if (!bloom_filter_.MayContain(key)) {
+        LOG("\t\tkey " << key << " filtered out by bloom filter of " << file_path_);
+        return false;
+    }
+
+    return true;
+}
+
+optional<int64_t> SSTable::Get(const int64_t key) const {
+    if (!MayContain(key)) {
         return nullopt;
     }
 
@@ -169,44 +489,29 @@ optional<int64_t> SSTable::BinarySearch(const int64_t key) const {
         const size_t mid = left + (right - left) / 2;
         const off_t offset = mid * kPageSize;
 
-        const Page *page = GetPage(offset);
-        const auto data = page->data_;
-        const size_t num_pairs = page->GetSize() / 2;
+        const PageHandle page = GetPage(offset);
+        const LeafPage leaf = AsLeaf(page);
+        const size_t num_pairs = leaf.NumPairs();
 
-        const int64_t first_key = data[0];
-        const int64_t last_key = data[(num_pairs - 1) * 2];
+        const int64_t first_key = leaf.Key(0);
+        const int64_t last_key = leaf.Key(num_pairs - 1);
 
         if (key == first_key) {
             LOG("\t\tFound key " << key << " in " << file_path_);
-            return data[1];
+            return leaf.Value(0);
         }
         if (key == last_key) {
             LOG("\t\tFound key " << key << " in " << file_path_);
-            return data[num_pairs * 2 - 1];
+            return leaf.Value(num_pairs - 1);
         }
 
         if (key > first_key && key < last_key) {
-            // Since the key is already in order, do another binary search to search inside the page
-            size_t page_left = 0;
-            size_t page_right = num_pairs - 1;
-
-            while (page_left <= page_right) {
-                const size_t page_mid = page_left + (page_right - page_left) / 2;
-                const int64_t mid_key = data[page_mid * 2];
-
-                if (mid_key == key) {
-                    LOG("\t\tFound key " << key << " in " << file_path_);
-                    return data[page_mid * 2 + 1];
-                }
-
-                if (mid_key < key) {
-                    page_left = page_mid + 1;
-                } else {
-                    page_right = page_mid - 1;
-                }
+            // Since the key is already in order, search inside the page
+            const auto value = leaf.Find(key);
+            if (value) {
+                LOG("\t\tFound key " << key << " in " << file_path_);
             }
-
-            return nullopt;
+            return value;
         }
 
         if (key < first_key) {
@@ -220,6 +525,13 @@ optional<int64_t> SSTable::BinarySearch(const int64_t key) const {
     return nullopt;
 }
 
+size_t SSTable::EstimateScanPages(const int64_t start_key, const int64_t end_key) const {
+    if (max_key_ < start_key || min_key_ > end_key) {
+        return 0;
+    }
+    return (DataEndOffset() - DataStartOffset() + kPageSize - 1) / kPageSize;
+}
+
 vector<pair<int64_t, int64_t>> SSTable::Scan(const int64_t start_key, const int64_t end_key) const {
     vector<pair<int64_t, int64_t>> result;
 
@@ -231,14 +543,15 @@ vector<pair<int64_t, int64_t>> SSTable::Scan(const int64_t start_key, const int6
         return result;
     }
 
-    const bool is_sequential_flooding = (end_key - start_key + 1) / kPagePairs >= kPageSequentialFlooding;
+    // Count the pages from the index, not the keys in the range, keys may be sparse
+    const bool is_sequential_flooding = EstimateScanPages(start_key, end_key) >= kPageSequentialFlooding;
 
     int64_t start_offset;
     if (min_key_ > start_key) {
         // Min key is larger than end key, scan from the beginning
         LOG("\t\tMin key " << min_key_ << " is larger than start key " << start_key << ", scan from the beginning");
 
-        start_offset = 0;
+        start_offset = DataStartOffset();
     } else {
         if (is_sequential_flooding) {
             LOG("  Scan range exceeds sequential flooding threshold, skipping buffer pool writes");
@@ -250,7 +563,10 @@ vector<pair<int64_t, int64_t>> SSTable::Scan(const int64_t start_key, const int6
     // LOG("\t\t\tStart offset: " << start_offset);
 
     // Found start key, linear search to find end key
+    // Through mmap, let the kernel read ahead for the scan, then go back to random access
+    Advise(start_offset, DataEndOffset(), MADV_SEQUENTIAL);
     const auto values = LinearSearchToEndKey(start_offset, start_key, end_key, is_sequential_flooding);
+    Advise(start_offset, DataEndOffset(), MADV_RANDOM);
     for (const auto &[key, value]: values) {
         result.emplace_back(key, value);
     }
@@ -270,11 +586,8 @@ int64_t SSTable::BinarySearchUpperbound(const int64_t key, bool is_sequential_fl
         const size_t mid = left + (right - left) / 2;
         const off_t offset = mid * kPageSize;
 
-        const Page *page = GetPage(offset, is_sequential_flooding);
-        const auto data = page->data_;
-        const size_t num_pairs = page->GetSize() / 2;
-
-        const int64_t first_key = data[0];
+        const PageHandle page = GetPage(offset, is_sequential_flooding);
+        const int64_t first_key = AsLeaf(page).Key(0);
 
         if (first_key <= key) {
             left = mid + 1;
@@ -292,24 +605,12 @@ int64_t SSTable::BinarySearchUpperbound(const int64_t key, bool is_sequential_fl
     const size_t page_index = left - 1;
     const off_t page_offset = page_index * kPageSize;
 
-    const Page *page = GetPage(page_offset, is_sequential_flooding);
-    const auto data = page->data_;
-    const size_t num_pairs = page->GetSize() / 2;
+    const PageHandle page = GetPage(page_offset, is_sequential_flooding);
+    const LeafPage leaf = AsLeaf(page);
+    const size_t num_pairs = leaf.NumPairs();
 
-    // Inner binary search to find the upper bound within the page
-    size_t page_left = 0;
-    size_t page_right = num_pairs;
-
-    while (page_left < page_right) {
-        const size_t page_mid = page_left + (page_right - page_left) / 2;
-        const int64_t mid_key = data[page_mid * 2];
-
-        if (mid_key <= key) {
-            page_left = page_mid + 1;
-        } else {
-            page_right = page_mid;
-        }
-    }
+    // Inner search to find the upper bound within the page
+    const size_t page_left = leaf.UpperBound(key);
 
     if (page_left - 1 == num_pairs) {
         // All keys in this page are less than or equal to the given key
@@ -338,25 +639,26 @@ vector<pair<int64_t, int64_t>> SSTable::LinearSearchToEndKey(off_t start_offset,
 
     auto current_offset = start_offset;
 
+    // Leaves are read in order, in windows growing up to the leaf holding end key
+    Readahead readahead(this, is_sequential_flooding, ScanEndOffset(end_key));
+
     while (true) {
-        const Page *page = GetPage(current_offset, is_sequential_flooding);
+        const PageHandle page = readahead.GetPage(current_offset);
 
-        // When start key is the last key in the SSTable, next page will be nullptr
-        if (page == nullptr) {
+        // When start key is the last key in the SSTable, there is no next page
+        if (!page) {
             return result;
         }
 
-        const auto data = page->data_;
-        const size_t num_pairs = page->GetSize() / 2;
-
-        for (size_t i = 0; i < num_pairs; i++) {
-            if (data[i * 2] > end_key) {
-                return result;
-            }
-
-            if (data[i * 2] >= start_key) {
-                result.emplace_back(data[i * 2], data[i * 2 + 1]);
-            }
+        // Pairs from start key up to end key, found by searching the keys rather than comparing every one
+        const LeafPage leaf = AsLeaf(page);
+        const size_t begin = leaf.LowerBound(start_key);
+        const size_t end = leaf.UpperBound(end_key);
+        for (size_t i = begin; i < end; i++) {
+            result.emplace_back(leaf.Key(i), leaf.Value(i));
+        }
+        if (end < leaf.NumPairs()) {
+            return result;
         }
 
         current_offset += kPageSize;
@@ -0,0 +1,78 @@
+//
+// Created by Kiiro Huang on 2024-12-05.
+//
+
+#include "../include/sstable_iterator.h"
+
+#include <algorithm>
+#include <sys/mman.h>
+
+#include "../utils/constants.h"
+
+SSTableIterator::SSTableIterator(const SSTable *sst, const bool is_sequential_flooding,
+                                 const off_t readahead_end_offset) :
+    sst_(sst), is_sequential_flooding_(is_sequential_flooding) {
+    if (readahead_end_offset >= 0) {
+        readahead_.emplace(sst_, is_sequential_flooding_, readahead_end_offset);
+    }
+}
+
+SSTableIterator::~SSTableIterator() {
+    // Through mmap, the scan is over, go back to random access
+    if (advised_offset_ >= 0) {
+        sst_->Advise(advised_offset_, sst_->DataEndOffset(), MADV_RANDOM);
+    }
+}
+
+void SSTableIterator::Seek(const int64_t key) {
+    offset_ = -1;
+    page_ = PageHandle();
+    leaf_ = LeafPage();
+
+    // Max key is smaller than key, nothing to iterate
+    if (sst_->max_key_ < key) {
+        return;
+    }
+
+    // Min key is not smaller than key, start from the beginning, else find the page through the index
+    const off_t offset = sst_->min_key_ >= key ? sst_->DataStartOffset()
+                                               : sst_->BinarySearchUpperbound(key, is_sequential_flooding_);
+    if (offset < 0) {
+        return;
+    }
+
+    // Through mmap, let the kernel read ahead for the scan
+    sst_->Advise(offset, sst_->DataEndOffset(), MADV_SEQUENTIAL);
+    advised_offset_ = advised_offset_ < 0 ? offset : min(advised_offset_, offset);
+
+    ReadPage(offset - offset % kPageSize);
+
+    // Skip the keys smaller than key in the first page with one search, then pair by pair if the page had none
+    if (Valid()) {
+        index_ = leaf_.LowerBound(key);
+        if (index_ == leaf_.NumPairs()) {
+            ReadPage(offset_ + kPageSize);
+        }
+    }
+    while (Valid() && Key() < key) {
+        Next();
+    }
+}
+
+void SSTableIterator::Next() {
+    if (++index_ < leaf_.NumPairs()) {
+        return;
+    }
+
+    ReadPage(offset_ + kPageSize);
+}
+
+void SSTableIterator::ReadPage(const off_t offset) {
+    // The previous page is unpinned before the next one is read
+    page_ = PageHandle();
+    page_ = readahead_ ? readahead_->GetPage(offset) : sst_->GetPage(offset, is_sequential_flooding_);
+    leaf_ = page_ ? sst_->AsLeaf(page_) : LeafPage();
+    index_ = 0;
+
+    offset_ = leaf_.NumPairs() > 0 ? offset : -1;
+}
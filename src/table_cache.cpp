@@ -0,0 +1,67 @@
+//
+// Created by Kiiro Huang on 2024-12-04.
+//
+
+#include "../include/table_cache.h"
+
+#include <algorithm>
+
+#include "../include/sstable.h"
+#include "../utils/log.h"
+
+TableCache &TableCache::GetInstance() {
+    static TableCache instance;
+    return instance;
+}
+
+void TableCache::SetCapacity(const size_t max_open_files) {
+    lock_guard lock(mutex_);
+
+    // At least the SST being read must stay open
+    capacity_ = max(static_cast<size_t>(1), max_open_files);
+    EvictToCapacity(nullptr);
+}
+
+void TableCache::Touch(const SSTable *sst) {
+    lock_guard lock(mutex_);
+
+    if (const auto it = entries_.find(sst); it != entries_.end()) {
+        // Already open, move it to the front
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+
+    lru_.push_front(sst);
+    entries_[sst] = lru_.begin();
+
+    EvictToCapacity(sst);
+}
+
+void TableCache::Erase(const SSTable *sst) {
+    lock_guard lock(mutex_);
+
+    if (const auto it = entries_.find(sst); it != entries_.end()) {
+        lru_.erase(it->second);
+        entries_.erase(it);
+    }
+}
+
+void TableCache::EvictToCapacity(const SSTable *keep) {
+    auto it = lru_.end();
+    while (entries_.size() > capacity_ && it != lru_.begin()) {
+        const SSTable *victim = *--it;
+
+        // The caller is reading keep, a file locked by another thread is being read, they stay open for now
+        // try_lock never waits, so the file mutex and mutex_ are never waited on in the opposite order
+        if (victim == keep || !victim->file_mutex_.try_lock()) {
+            continue;
+        }
+
+        LOG("  Table cache is full, closing " << victim->file_path_);
+        victim->CloseFds();
+        victim->file_mutex_.unlock();
+
+        entries_.erase(victim);
+        it = lru_.erase(it);
+    }
+}
@@ -0,0 +1,196 @@
+//
+// Created by Kiiro Huang on 2024-12-07.
+//
+
+#include "../include/write_ahead_log.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <unistd.h>
+
+#include "../external/MurmurHash3.h"
+#include "../utils/log.h"
+
+namespace fs = std::filesystem;
+
+WriteAheadLog::WriteAheadLog(const string &db_name, const int64_t number, const WalSyncMode sync_mode,
+                             const size_t sync_interval_ms) :
+    db_name_(db_name), sync_mode_(sync_mode), sync_interval_(sync_interval_ms), number_(number) {
+    OpenFile();
+
+    if (sync_mode_ == WalSyncMode::kInterval) {
+        sync_thread_ = thread(&WriteAheadLog::SyncLoop, this);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    if (sync_thread_.joinable()) {
+        {
+            lock_guard lock(mutex_);
+            is_closing_ = true;
+        }
+        sync_cv_.notify_all();
+        sync_thread_.join();
+    }
+
+    lock_guard lock(mutex_);
+    if (sync_mode_ != WalSyncMode::kNever) {
+        SyncLocked();
+    }
+    close(fd_);
+}
+
+string WriteAheadLog::LogPath(const string &db_name, const int64_t number) {
+    return fs::path(db_name) / ("wal_" + to_string(number) + ".log");
+}
+
+void WriteAheadLog::OpenFile() {
+    const string file_path = LogPath(db_name_, number_);
+    fd_ = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open log file: " + file_path);
+    }
+    LOG("  Open log file: " << file_path);
+}
+
+uint64_t WriteAheadLog::Checksum(const int64_t *data, const size_t size) {
+    uint64_t hash[2];
+    MurmurHash3_x64_128(data, static_cast<int>(size * sizeof(int64_t)), kWalChecksumSeed, hash);
+    return hash[0];
+}
+
+void WriteAheadLog::Append(const vector<pair<int64_t, int64_t>> &pairs) {
+    // Number of pairs, the pairs, then the checksum of both
+    vector<int64_t> record;
+    record.reserve(pairs.size() * 2 + 2);
+    record.push_back(static_cast<int64_t>(pairs.size()));
+    for (const auto &[key, value]: pairs) {
+        record.push_back(key);
+        record.push_back(value);
+    }
+    record.push_back(static_cast<int64_t>(Checksum(record.data(), record.size())));
+
+    lock_guard lock(mutex_);
+
+    const auto buffer = reinterpret_cast<const char *>(record.data());
+    const size_t size = record.size() * sizeof(int64_t);
+    size_t written = 0;
+    while (written < size) {
+        const ssize_t bytes_written = write(fd_, buffer + written, size - written);
+        if (bytes_written < 0) {
+            cerr << "Failed to write log file: " << LogPath(db_name_, number_) << endl;
+            exit(1);
+        }
+        written += bytes_written;
+    }
+    is_dirty_ = true;
+
+    if (sync_mode_ == WalSyncMode::kEveryWrite) {
+        SyncLocked();
+    }
+}
+
+void WriteAheadLog::SyncLocked() {
+    if (!is_dirty_) {
+        return;
+    }
+
+#ifdef __APPLE__
+    const int result = fsync(fd_);
+#else
+    const int result = fdatasync(fd_);
+#endif
+    if (result < 0) {
+        cerr << "Failed to sync log file: " << LogPath(db_name_, number_) << endl;
+        exit(1);
+    }
+    is_dirty_ = false;
+}
+
+void WriteAheadLog::SyncLoop() {
+    unique_lock lock(mutex_);
+    while (!is_closing_) {
+        sync_cv_.wait_for(lock, sync_interval_, [this] { return is_closing_; });
+        SyncLocked();
+    }
+}
+
+int64_t WriteAheadLog::Roll() {
+    lock_guard lock(mutex_);
+
+    // The closed file is replayed if the database crashes before its memtable is flushed
+    if (sync_mode_ != WalSyncMode::kNever) {
+        SyncLocked();
+    }
+    close(fd_);
+    is_dirty_ = false;
+
+    const int64_t closed_number = number_++;
+    OpenFile();
+
+    return closed_number;
+}
+
+vector<int64_t> WriteAheadLog::ListLogs(const string &db_name) {
+    vector<int64_t> numbers;
+    const regex filename_pattern(R"(wal_(\d+)\.log)");
+
+    for (const auto &entry: fs::directory_iterator(db_name)) {
+        const string filename = entry.path().filename().string();
+        smatch match;
+        if (regex_match(filename, match, filename_pattern)) {
+            numbers.push_back(stoll(match[1].str()));
+        }
+    }
+
+    ranges::sort(numbers);
+    return numbers;
+}
+
+vector<pair<int64_t, int64_t>> WriteAheadLog::ReadLog(const string &db_name, const int64_t number) {
+    const string file_path = LogPath(db_name, number);
+
+    vector<int64_t> data(fs::file_size(file_path) / sizeof(int64_t));
+    ifstream file(file_path, ios::binary);
+    file.read(reinterpret_cast<char *>(data.data()), static_cast<streamsize>(data.size() * sizeof(int64_t)));
+    if (!file) {
+        cerr << "Failed to read log file: " << file_path << endl;
+        exit(1);
+    }
+
+    vector<pair<int64_t, int64_t>> pairs;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        // A record cut short or not matching its checksum was being written when the database crashed
+        const size_t remaining = data.size() - pos;
+        const int64_t num_pairs = data[pos];
+        if (remaining < 2 || num_pairs < 0 || static_cast<size_t>(num_pairs) > (remaining - 2) / 2) {
+            LOG("  Torn record at the end of log file: " << file_path);
+            break;
+        }
+
+        const size_t record_size = num_pairs * 2 + 1;
+        if (Checksum(&data[pos], record_size) != static_cast<uint64_t>(data[pos + record_size])) {
+            LOG("  Corrupt record at the end of log file: " << file_path);
+            break;
+        }
+
+        for (size_t i = pos + 1; i < pos + record_size; i += 2) {
+            pairs.emplace_back(data[i], data[i + 1]);
+        }
+        pos += record_size + 1;
+    }
+
+    return pairs;
+}
+
+void WriteAheadLog::RemoveLog(const string &db_name, const int64_t number) {
+    const string file_path = LogPath(db_name, number);
+    if (!fs::remove(file_path)) {
+        cerr << "Failed to delete log file: " << file_path << endl;
+    }
+}
@@ -0,0 +1,142 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../include/async_reader.h"
+#include "../include/b_tree/b_tree_sstable.h"
+#include "../include/buffer_pool/buffer_pool_manager.h"
+#include "../include/database.h"
+#include "test_base.h"
+
+class TestAsyncReader : public TestBase {
+    // Reads every page of a file of 2.5 pages of increasing int64s in one batch
+    static bool ReadFile(AsyncReader &reader) {
+        const string file_path = "test_async_reader.bin";
+        const size_t num_values = kPageSize * 5 / 2 / sizeof(int64_t);
+        {
+            vector<int64_t> values(num_values);
+            for (size_t i = 0; i < num_values; ++i) {
+                values[i] = static_cast<int64_t>(i);
+            }
+            ofstream file(file_path, ios::binary);
+            file.write(reinterpret_cast<const char *>(values.data()), num_values * sizeof(int64_t));
+        }
+
+        const int fd = open(file_path.c_str(), O_RDONLY);
+        assert(fd >= 0);
+
+        // Pages out of order, the last one is read short, the one past the end reads nothing
+        vector<vector<int64_t>> buffers(4, vector<int64_t>(kPageSize / sizeof(int64_t), -1));
+        vector<ReadRequest> requests;
+        for (const off_t page: {2, 0, 1, 3}) {
+            const off_t offset = page * kPageSize;
+            requests.push_back({fd, buffers[requests.size()].data(), kPageSize, offset});
+        }
+        reader.ReadAll(requests);
+        close(fd);
+        filesystem::remove(file_path);
+
+        assert(requests[0].result == kPageSize / 2);
+        assert(requests[1].result == kPageSize);
+        assert(requests[2].result == kPageSize);
+        assert(requests[3].result == 0);
+
+        const size_t values_per_page = kPageSize / sizeof(int64_t);
+        for (size_t i = 0; i < values_per_page; ++i) {
+            assert(buffers[1][i] == static_cast<int64_t>(i));
+            assert(buffers[2][i] == static_cast<int64_t>(values_per_page + i));
+        }
+        for (size_t i = 0; i < values_per_page / 2; ++i) {
+            assert(buffers[0][i] == static_cast<int64_t>(2 * values_per_page + i));
+        }
+        assert(buffers[0][values_per_page / 2] == -1);
+
+        // A bad descriptor fails its read only
+        vector<int64_t> buffer(values_per_page);
+        ReadRequest bad_request{-1, buffer.data(), kPageSize, 0};
+        reader.ReadAll(span(&bad_request, 1));
+        assert(bad_request.result == -EBADF);
+
+        return true;
+    }
+
+    static bool TestThreadPoolReader() {
+        ThreadPoolReader reader(4);
+        return ReadFile(reader);
+    }
+
+    static bool TestIoUringReader() {
+        // Nothing to test where the kernel has no io_uring, the thread pool is used instead
+        if (!IoUringReader::IsSupported()) {
+            return true;
+        }
+        IoUringReader reader;
+        return ReadFile(reader);
+    }
+
+    static bool TestGetPages() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+
+        vector<BTreeSSTable *> ssts;
+        for (auto n = 0; n < 2; ++n) {
+            const auto sst = new BTreeSSTable(db_name, true);
+            vector<int64_t> data;
+            for (auto i = 1; i <= 2048; ++i) {
+                data.push_back(i);
+                data.push_back(i * 10 + n);
+            }
+            sst->FlushToStorage(&data);
+            ssts.push_back(sst);
+        }
+        BufferPoolManager::GetInstance()->Clear();
+
+        // One page is cached, the others are read in one batch
+        const auto cached_page = ssts[0]->GetPage(ssts[0]->leaf_start_offset_);
+        vector<pair<const SSTable *, off_t>> pages;
+        for (off_t leaf = 0; leaf < 4; ++leaf) {
+            for (const auto sst: ssts) {
+                pages.emplace_back(sst, sst->leaf_start_offset_ + leaf * kPageSize);
+            }
+        }
+        pages.emplace_back(ssts[1], ssts[1]->leaf_end_offset_);
+        const auto handles = SSTable::GetPages(pages);
+
+        assert(handles.size() == pages.size());
+        assert(handles[0].Data().data() == cached_page.Data().data());
+        assert(!handles.back());
+        for (size_t i = 0; i + 1 < handles.size(); ++i) {
+            const auto [sst, offset] = pages[i];
+            const auto page = sst->GetPage(offset);
+            assert(handles[i].GetSize() == page.GetSize());
+            assert(ranges::equal(handles[i].Data(), page.Data()));
+
+            // Pages read in the batch are cached as if read one at a time
+            assert(handles[i].Data().data() == page.Data().data());
+        }
+        assert(handles[3].Data()[0] == handles[2].Data()[0]);
+        assert(handles[3].Data()[1] == handles[2].Data()[1] + 1);
+
+        for (const auto sst: ssts) {
+            delete sst;
+        }
+
+        return true;
+    }
+
+public:
+    bool RunTests() override {
+        bool result = true;
+        result &= AssertTrue(TestThreadPoolReader, "TestAsyncReader::TestThreadPoolReader");
+        result &= AssertTrue(TestIoUringReader, "TestAsyncReader::TestIoUringReader");
+        result &= AssertTrue(TestGetPages, "TestAsyncReader::TestGetPages");
+        return result;
+    }
+};
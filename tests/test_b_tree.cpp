@@ -7,6 +7,7 @@
 #include <iostream>
 
 #include "../include/b_tree/b_tree_sstable.h"
+#include "../include/buffer_pool/buffer_pool_manager.h"
 #include "../include/database.h"
 #include "test_base.h"
 
@@ -35,10 +36,94 @@ class TestBTree : public TestBase {
         return true;
     }
 
+    static bool TestIndexLookup() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+
+        const auto btree = new BTreeSSTable(db_name, true);
+
+        // 300 leaves, which needs 2 internal nodes
+        vector<int64_t> data;
+        for (auto i = 1; i <= 300 * 256; ++i) {
+            data.push_back(i * 2);
+            data.push_back(i * 100);
+        }
+        btree->FlushToStorage(&data);
+        assert(btree->root_ == vector<int64_t>({256 * 2 * 256, 300 * 256 * 2}));
+        assert(btree->internal_nodes_.size() == 2);
+        assert(btree->internal_nodes_[1].size() == 300 - 256);
+
+        // Reopen the SST, root and internal nodes are read back into memory
+        const auto reopened = new BTreeSSTable(btree->file_path_, false);
+        assert(reopened->root_ == btree->root_);
+        assert(reopened->internal_nodes_ == btree->internal_nodes_);
+
+        // A point lookup reads only the leaf page
+        const auto buffer_pool = BufferPoolManager::GetInstance();
+        buffer_pool->Clear();
+        assert(reopened->Get(70000 * 2).value() == 70000 * 100);
+        assert(buffer_pool->Size() == 1);
+
+        assert(reopened->Get(1 * 2).value() == 100);
+        assert(reopened->Get(300 * 256 * 2).value() == 300 * 256 * 100);
+        assert(!reopened->Get(70000 * 2 + 1).has_value());
+        assert(!reopened->Get(300 * 256 * 2 + 2).has_value());
+
+        // Scan starts from the leaf found through the index
+        const auto res = reopened->Scan(0, 600);
+        assert(res.size() == 300);
+        assert(res.front().first == 2);
+        assert(res.back().first == 600);
+
+        delete btree;
+        delete reopened;
+
+        return true;
+    }
+
+    static bool TestMultiGet() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+
+        const auto btree = new BTreeSSTable(db_name, true);
+
+        // 300 leaves of even keys
+        vector<int64_t> data;
+        for (auto i = 1; i <= 300 * 256; ++i) {
+            data.push_back(i * 2);
+            data.push_back(i * 100);
+        }
+        btree->FlushToStorage(&data);
+
+        // Keys of 3 leaves, odd keys and keys past the end are not found
+        const vector<int64_t> keys = {0, 2, 3, 100, 512, 514, 70000 * 2, 70000 * 2 + 1, 70001 * 2, 300 * 256 * 2 + 2};
+        const auto buffer_pool = BufferPoolManager::GetInstance();
+        buffer_pool->Clear();
+        const auto values = btree->MultiGet(keys);
+        assert(buffer_pool->Size() == 3);
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            const bool is_present = keys[i] >= 2 && keys[i] % 2 == 0 && keys[i] <= 300 * 256 * 2;
+            assert(values[i] == (is_present ? optional<int64_t>(keys[i] * 50) : nullopt));
+        }
+
+        delete btree;
+
+        return true;
+    }
+
 public:
     bool RunTests() override {
         bool result = true;
         result &= AssertTrue(TestBuildBTree, "TestBTree::TestBuildBTree");
+        result &= AssertTrue(TestIndexLookup, "TestBTree::TestIndexLookup");
+        result &= AssertTrue(TestMultiGet, "TestBTree::TestMultiGet");
         return result;
     }
 };
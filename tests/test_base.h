@@ -5,6 +5,7 @@
 #ifndef TESTBASE_H
 #define TESTBASE_H
 
+#include <functional>
 #include <iostream>
 
 using namespace std;
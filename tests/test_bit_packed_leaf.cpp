@@ -0,0 +1,87 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <random>
+
+#include "../include/bit_packed_leaf.h"
+#include "test_base.h"
+
+class TestBitPackedLeaf : public TestBase {
+    // Adds pairs to a leaf until it is full, then checks the leaf encodes within a page and decodes back
+    static size_t FillLeaf(const function<pair<int64_t, int64_t>(size_t)> &next_pair) {
+        BitPackedLeaf leaf;
+        PageData pairs;
+        vector<int64_t> values;
+        for (size_t i = 0;; ++i) {
+            const auto [key, value] = next_pair(i);
+            if (!leaf.Fits(key, value)) {
+                break;
+            }
+            leaf.Add(key, value);
+            pairs.push_back(key);
+            values.push_back(value);
+        }
+
+        // The keys, then the values
+        pairs.insert(pairs.end(), values.begin(), values.end());
+
+        const PageData words = BitPackedLeaf::Encode(pairs);
+        assert(words.size() * sizeof(int64_t) <= kPageSize);
+
+        PageData decoded;
+        assert(BitPackedLeaf::Decode(words, decoded));
+        assert(decoded == pairs);
+
+        // Fewer words than the header says are rejected
+        assert(!BitPackedLeaf::Decode(span(words.data(), words.size() - 1), decoded));
+
+        return pairs.size() / 2;
+    }
+
+    static bool TestRoundTrip() {
+        // Dense keys take no bits, the leaf is full at kMaxBitPackedLeafPairs
+        assert(FillLeaf([](const size_t i) { return make_pair(int64_t(i) + 1, int64_t(i) * 10); }) ==
+               kMaxBitPackedLeafPairs);
+
+        // Sparse keys and values of byte widths
+        assert(FillLeaf([](const size_t i) { return make_pair(int64_t(i) * 200, int64_t(i) % 256); }) > kPagePairs);
+        assert(FillLeaf([](const size_t i) { return make_pair(int64_t(i) * 65536, -int64_t(i)); }) > kPagePairs);
+
+        // Tombstones stretch the values over the whole range, the leaf still holds no fewer pairs than a raw one
+        assert(FillLeaf([](const size_t i) {
+                   return make_pair(int64_t(i) * 3 - 1000, i % 7 == 0 ? INT64_MIN : int64_t(i));
+               }) >= kMinBitPackedLeafPairs);
+
+        // Keys and values over the whole range of int64_t
+        mt19937_64 rng(42);
+        vector<int64_t> keys(kMaxBitPackedLeafPairs);
+        for (auto &key: keys) {
+            key = static_cast<int64_t>(rng());
+        }
+        ranges::sort(keys);
+        keys.erase(ranges::unique(keys).begin(), keys.end());
+        assert(FillLeaf([&](const size_t i) { return make_pair(keys[i], static_cast<int64_t>(rng())); }) >=
+               kMinBitPackedLeafPairs);
+
+        // Keys and values are decoded columnar
+        PageData decoded;
+        assert(BitPackedLeaf::Decode(BitPackedLeaf::Encode(PageData{1, 5, 9, 10, 50, 90}), decoded));
+        assert((decoded == PageData{1, 5, 9, 10, 50, 90}));
+
+        // One pair
+        assert(BitPackedLeaf::Decode(BitPackedLeaf::Encode(PageData{INT64_MAX, INT64_MIN}), decoded));
+        assert((decoded == PageData{INT64_MAX, INT64_MIN}));
+
+        return true;
+    }
+
+public:
+    bool RunTests() override {
+        bool result = true;
+        result &= AssertTrue(TestRoundTrip, "TestBitPackedLeaf::TestRoundTrip");
+        return result;
+    }
+};
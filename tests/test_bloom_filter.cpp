@@ -0,0 +1,87 @@
+//
+// Created by Kiiro Huang on 2024-12-02.
+//
+
+#include <cassert>
+
+#include "../include/b_tree/b_tree_sstable.h"
+#include "../include/bloom_filter.h"
+#include "../include/database.h"
+#include "test_base.h"
+
+class TestBloomFilter : public TestBase {
+    static bool TestNoFalseNegative() {
+        BloomFilter bloom_filter(1000);
+        for (auto i = 1; i <= 1000; ++i) {
+            bloom_filter.Put(i * 7);
+        }
+
+        // Every key put into the filter must be reported as present
+        for (auto i = 1; i <= 1000; ++i) {
+            assert(bloom_filter.MayContain(i * 7));
+        }
+
+        // With 10 bits per key, false positive rate should be around 1%
+        size_t false_positives = 0;
+        for (auto i = 1; i <= 10000; ++i) {
+            if (bloom_filter.MayContain(-i)) {
+                ++false_positives;
+            }
+        }
+        assert(false_positives < 300);
+
+        return true;
+    }
+
+    static bool TestPersistInSst() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+
+        const auto btree = new BTreeSSTable(db_name, true);
+
+        vector<int64_t> data;
+        for (auto i = 1; i <= 2048; ++i) {
+            data.push_back(i * 2);
+            data.push_back(i * 100);
+        }
+        btree->FlushToStorage(&data);
+        const string file_path = btree->file_path_;
+        delete btree;
+
+        // Reopen the SST, the bloom filter is read back from the file
+        const auto reopened = new BTreeSSTable(file_path, false);
+        assert(!reopened->bloom_filter_.Empty());
+        assert(reopened->min_key_ == 2);
+        assert(reopened->max_key_ == 4096);
+
+        for (auto i = 1; i <= 2048; ++i) {
+            assert(reopened->MayContain(i * 2));
+            assert(reopened->Get(i * 2).value() == i * 100);
+        }
+
+        // Odd keys are in the key range, but most of them are filtered out
+        size_t filtered = 0;
+        for (auto i = 1; i <= 2048; ++i) {
+            if (!reopened->MayContain(i * 2 + 1)) {
+                ++filtered;
+            }
+            assert(!reopened->Get(i * 2 + 1).has_value());
+        }
+        assert(filtered > 1900);
+
+        delete reopened;
+
+        return true;
+    }
+
+public:
+    bool RunTests() override {
+        bool result = true;
+        result &= AssertTrue(TestNoFalseNegative, "TestBloomFilter::TestNoFalseNegative");
+        result &= AssertTrue(TestPersistInSst, "TestBloomFilter::TestPersistInSst");
+        return result;
+    }
+};
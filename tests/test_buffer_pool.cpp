@@ -4,71 +4,500 @@
 
 #include <cassert>
 #include <iostream>
+#include <random>
+#include <thread>
 
 #include "../include/buffer_pool/buffer_pool.h"
+#include "../include/buffer_pool/clock/clock.h"
+#include "../include/buffer_pool/lru/lru.h"
+#include "../include/buffer_pool/lru_k/lru_k.h"
+#include "../include/buffer_pool/two_q/two_q.h"
 #include "test_base.h"
 
 class TestBufferPool : public TestBase {
+    // Queue of the only shard of a small buffer pool evicting by LRU
+    static PageQueue &LruQueue(const BufferPool *bufferPool) {
+        return static_cast<LRU *>(bufferPool->shards_[0]->eviction_policy_)->queue_;
+    }
+
+    // Data of a full page, a budget of n * kPageSize bytes holds n - 1 of them with their metadata
+    static PageData FullPage(const int64_t value) { return PageData(2 * kPagePairs, value); }
+
     static bool TestBuckets() {
-        BufferPool *bufferPool = new BufferPool(4);
+        BufferPool *bufferPool = new BufferPool(4 * kPageSize);
 
-        const string page1_id = "test1_128";
-        const string page2_id = "test2_128";
-        const string page3_id = "test1_256";
-        auto page1_data = vector<int64_t>(1, 1);
-        auto page2_data = vector<int64_t>(2, 2);
-        auto page3_data = vector<int64_t>(3, 3);
+        const PageId page1_id = MakePageId(1, 1);
+        const PageId page2_id = MakePageId(2, 1);
+        const PageId page3_id = MakePageId(1, 2);
+        auto page1_data = PageData(1, 1);
+        auto page2_data = PageData(2, 2);
+        auto page3_data = PageData(3, 3);
 
         bufferPool->Put(page1_id, page1_data);
         bufferPool->Put(page2_id, page2_data);
         bufferPool->Put(page3_id, page3_data);
 
         // Check if the data are in the same address
-        assert(bufferPool->Get("test1_128")->data_ == page1_data);
-        assert(bufferPool->Get("test2_128")->data_ == page2_data);
-        assert(bufferPool->Get("test1_256")->data_ == page3_data);
+        assert(bufferPool->Get(MakePageId(1, 1))->data_ == page1_data);
+        assert(bufferPool->Get(MakePageId(2, 1))->data_ == page2_data);
+        assert(bufferPool->Get(MakePageId(1, 2))->data_ == page3_data);
+        assert(!bufferPool->Get(MakePageId(2, 2)));
 
         return true;
     }
 
     static bool TestLRU() {
-        BufferPool *bufferPool = new BufferPool(4);
+        BufferPool *bufferPool = new BufferPool(4 * kPageSize);
 
-        const string page1_id = "test1_128";
-        const string page2_id = "test2_128";
-        const string page3_id = "test1_256";
-        auto page1_data = vector<int64_t>(1, 1);
-        auto page2_data = vector<int64_t>(2, 2);
-        auto page3_data = vector<int64_t>(3, 3);
+        const PageId page1_id = MakePageId(1, 1);
+        const PageId page2_id = MakePageId(2, 1);
+        const PageId page3_id = MakePageId(1, 2);
+        auto page1_data = PageData(1, 1);
+        auto page2_data = PageData(2, 2);
+        auto page3_data = PageData(3, 3);
 
         bufferPool->Put(page1_id, page1_data);
         bufferPool->Put(page2_id, page2_data);
         bufferPool->Put(page3_id, page3_data);
 
-        const Page *page2 = bufferPool->Get(page2_id);
+        const PageHandle page2 = bufferPool->Get(page2_id);
         bufferPool->Get(page1_id);
-        const Page *page3 = bufferPool->Get(page3_id);
+        const PageHandle page3 = bufferPool->Get(page3_id);
 
         // Check if the pages in the LRU queue are in the same address as the pages in the buffer pool
         // Check if the pages in the LRU queue are in the correct order
         // page3 should be the most recent (so in the back)
-        assert(bufferPool->eviction_policy_->front_->page_ == page2);
-        assert(bufferPool->eviction_policy_->rear_->page_ == page3);
+        assert(LruQueue(bufferPool).front_->page_ == page2.Get());
+        assert(LruQueue(bufferPool).rear_->page_ == page3.Get());
 
         return true;
     }
 
     static bool TestLRUEvict() {
-        BufferPool *bufferPool = new BufferPool(6);
+        BufferPool *bufferPool = new BufferPool(6 * kPageSize);
 
         for (int i = 0; i < 6; i++) {
-            bufferPool->Put("test" + to_string(i), vector<int64_t>(i, i));
+            bufferPool->Put(MakePageId(1, i), FullPage(i));
+        }
+
+        // The sixth page does not fit in the budget, the least recently used page is evicted
+        assert(bufferPool->Size() == 5);
+        assert(!bufferPool->Get(MakePageId(1, 0)));
+        assert(bufferPool->Bytes() <= bufferPool->capacity_);
+
+        const PageHandle page = bufferPool->Get(MakePageId(1, 4));
+
+        // Check if the pages in the LRU queue are in the correct order, page 4 should be the most recent
+        assert(LruQueue(bufferPool).rear_->page_ == page.Get());
+
+        return true;
+    }
+
+    static bool TestPinnedPage() {
+        BufferPool *bufferPool = new BufferPool(5 * kPageSize);
+
+        bufferPool->Put(MakePageId(1, 1), FullPage(1));
+        const PageHandle page1 = bufferPool->Get(MakePageId(1, 1));
+        for (int i = 2; i <= 4; i++) {
+            bufferPool->Put(MakePageId(1, i), FullPage(i));
+        }
+
+        // Pool is at its budget, the pinned page 1 is skipped and page 2 is evicted instead
+        bufferPool->Put(MakePageId(1, 5), FullPage(5));
+        assert(LruQueue(bufferPool).front_->page_ == page1.Get());
+        assert(LruQueue(bufferPool).front_->next_->page_->id_ == MakePageId(1, 3));
+        assert(!bufferPool->Get(MakePageId(1, 2)));
+
+        // A pinned page dropped from the pool stays readable until its last handle goes away
+        bufferPool->Clear();
+        assert(!bufferPool->Get(MakePageId(1, 1)));
+        assert(page1->data_ == FullPage(1));
+
+        delete bufferPool;
+
+        return true;
+    }
+
+    static bool TestLRUQueueNode() {
+        BufferPool *bufferPool = new BufferPool(8 * kPageSize);
+
+        for (int i = 0; i < 4; i++) {
+            bufferPool->Put(MakePageId(1, i), PageData(i, i));
+        }
+        const PageHandle page1 = bufferPool->Get(MakePageId(1, 1));
+        const PageHandle page2 = bufferPool->Get(MakePageId(1, 2));
+
+        // Every cached page links to its node in the LRU queue, a hit moves it to the rear in place
+        assert(page1->queue_node_->page_ == page1.Get());
+        assert(LruQueue(bufferPool).rear_ == page2->queue_node_);
+        assert(LruQueue(bufferPool).rear_->prev_ == page1->queue_node_);
+
+        // A page dropped from the pool is unlinked, even while a handle still reads it
+        bufferPool->RemoveSst(1);
+        assert(!page1->queue_node_ && !page2->queue_node_);
+        assert(LruQueue(bufferPool).size_ == 0);
+        assert(!LruQueue(bufferPool).front_ && !LruQueue(bufferPool).rear_);
+
+        bufferPool->Put(MakePageId(2, 0), PageData(1, 1));
+        const PageHandle page3 = bufferPool->Get(MakePageId(2, 0));
+        bufferPool->Clear();
+        assert(!page3->queue_node_);
+
+        delete bufferPool;
+
+        return true;
+    }
+
+    static bool TestFrameTable() {
+        FrameTable frames;
+        vector<Page *> pages;
+
+        // Pages of a few SSTs, enough to grow the table several times
+        for (uint32_t file_id = 1; file_id <= 4; file_id++) {
+            for (uint32_t page_no = 0; page_no < 1000; page_no++) {
+                pages.push_back(new Page(MakePageId(file_id, page_no)));
+                frames.Insert(pages.back());
+            }
+        }
+        assert(frames.Size() == 4000);
+        assert(frames.NumSlots() >= 8000);
+
+        for (Page *page: pages) {
+            assert(frames.Find(page->id_) == page);
+        }
+        assert(!frames.Find(MakePageId(5, 0)));
+        assert(!frames.Find(MakePageId(1, 1000)));
+
+        // Erasing shifts the following slots back, every other page is still found
+        for (size_t i = 0; i < pages.size(); i += 2) {
+            assert(frames.Erase(pages[i]->id_) == pages[i]);
+        }
+        assert(!frames.Erase(pages[0]->id_));
+        assert(frames.Size() == 2000);
+
+        for (size_t i = 0; i < pages.size(); i++) {
+            assert(frames.Find(pages[i]->id_) == (i % 2 == 0 ? nullptr : pages[i]));
+        }
+
+        size_t num_pages = 0;
+        frames.ForEach([&](const Page *page) {
+            assert(page->id_ % 2 == 1);
+            ++num_pages;
+        });
+        assert(num_pages == 2000);
+
+        frames.Clear();
+        assert(frames.Size() == 0);
+        assert(!frames.Find(pages[1]->id_));
+
+        for (const Page *page: pages) {
+            delete page;
+        }
+
+        return true;
+    }
+
+    static bool TestShards() {
+        // A small pool is not split, the budget of every shard holds at least kMinShardPages pages
+        BufferPool *smallPool = new BufferPool(4 * kPageSize);
+        assert(smallPool->shards_.size() == 1);
+        delete smallPool;
+
+        BufferPool *bufferPool = new BufferPool(kMinShardPages * kPageSize * kBufferPoolShards + 3);
+        assert(bufferPool->shards_.size() == kBufferPoolShards);
+        assert(bufferPool->shards_[0]->capacity_ == kMinShardPages * kPageSize + 1);
+        assert(bufferPool->shards_.back()->capacity_ == kMinShardPages * kPageSize);
+
+        // A page is cached by the shard its id hashes to, pages of one SST spread over every shard
+        for (uint32_t i = 0; i < 256; i++) {
+            const PageId id = MakePageId(1, i);
+            const PageHandle page = bufferPool->Put(id, PageData(1, i));
+            assert(bufferPool->GetShard(id)->frames_.Find(id) == page.Get());
+        }
+        for (const auto shard: bufferPool->shards_) {
+            assert(shard->Size() > 0);
+        }
+        assert(bufferPool->Size() == 256);
+
+        bufferPool->RemoveSst(1);
+        assert(bufferPool->Size() == 0);
+
+        delete bufferPool;
+
+        return true;
+    }
+
+    static bool TestConcurrentAccess() {
+        // Small enough that the threads keep evicting pages of each other
+        BufferPool *bufferPool = new BufferPool(kMinShardPages * kPageSize * 4);
+        constexpr int num_threads = 8;
+        constexpr uint32_t num_pages = 1024;
+
+        vector<thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([bufferPool, t] {
+                mt19937 gen(t);
+                for (int i = 0; i < 20000; i++) {
+                    const uint32_t page_no = gen() % num_pages;
+                    PageHandle page = bufferPool->Get(MakePageId(1, page_no));
+                    if (!page) {
+                        page = bufferPool->Put(MakePageId(1, page_no), FullPage(page_no));
+                    }
+                    // The pinned page is never freed or changed under the reader
+                    assert(page.Data()[1] == page_no);
+                }
+            });
+        }
+        for (auto &t: threads) {
+            t.join();
+        }
+
+        assert(bufferPool->Bytes() <= bufferPool->capacity_);
+
+        delete bufferPool;
+
+        return true;
+    }
+
+    // Pages as cached by a buffer pool, holding its pin
+    static vector<Page *> NewPages(const uint32_t num_pages) {
+        vector<Page *> pages;
+        for (uint32_t i = 0; i < num_pages; i++) {
+            pages.push_back(new Page(MakePageId(1, i)));
+            pages.back()->pin_count_ = 1;
+        }
+        return pages;
+    }
+
+    static bool TestClock() {
+        Clock clock;
+        const vector<Page *> pages = NewPages(4);
+        for (Page *page: pages) {
+            clock.Put(page->id_, page);
+        }
+
+        // Page 0 was read again, it gets a second chance and page 1 is evicted instead
+        clock.Touch(pages[0]);
+        assert(clock.Victim() == pages[1]);
+        clock.EvictPage(pages[1]);
+        assert(!pages[1]->queue_node_);
+        assert(clock.ring_.rear_->page_ == pages[0]);
+
+        // A pinned page is passed over
+        pages[2]->pin_count_ = 2;
+        assert(clock.Victim() == pages[3]);
+
+        // Every page read or pinned, the hand clears the bits and comes back to the first page not pinned
+        clock.Touch(pages[0]);
+        clock.Touch(pages[3]);
+        assert(clock.Victim() == pages[3]);
+
+        pages[0]->pin_count_ = 2;
+        pages[3]->pin_count_ = 2;
+        assert(!clock.Victim());
+
+        clock.Clear();
+        assert(clock.ring_.size_ == 0 && !pages[0]->queue_node_);
+
+        for (const Page *page: pages) {
+            delete page;
+        }
+
+        return true;
+    }
+
+    static bool TestTwoQ() {
+        // A1in takes 2 pages, A1out remembers 4 ids
+        TwoQ two_q(8);
+        vector<Page *> pages = NewPages(4);
+        for (Page *page: pages) {
+            two_q.Put(page->id_, page);
+        }
+
+        // A1in is over its share, evicted in FIFO order, reads in A1in do not count
+        two_q.Touch(pages[0]);
+        assert(two_q.Victim() == pages[0]);
+        two_q.EvictPage(pages[0]);
+        assert(two_q.a1out_ids_.contains(pages[0]->id_));
+
+        // Read again while remembered in A1out, the page goes to Am
+        Page *hot_page = new Page(pages[0]->id_);
+        hot_page->pin_count_ = 1;
+        two_q.Put(hot_page->id_, hot_page);
+        assert(two_q.am_.size_ == 1 && two_q.am_.front_->page_ == hot_page);
+        assert(!two_q.a1out_ids_.contains(hot_page->id_));
+
+        // A scan of pages read once goes through A1in, the hot page stays in Am
+        for (uint32_t i = 10; i < 30; i++) {
+            Page *page = new Page(MakePageId(1, i));
+            page->pin_count_ = 1;
+            pages.push_back(page);
+            two_q.Put(page->id_, page);
+
+            Page *victim = two_q.Victim();
+            assert(victim != hot_page);
+            two_q.EvictPage(victim);
+        }
+        assert(hot_page->queue_node_);
+        assert(two_q.a1out_.size() <= 4 && two_q.a1out_ids_.size() <= 4);
+
+        // With A1in within its share, Am gives up its least recently used page
+        while (two_q.a1in_.size_ > 2) {
+            two_q.EvictPage(two_q.Victim());
         }
+        assert(two_q.Victim() == hot_page);
+
+        two_q.Clear();
+        assert(!hot_page->queue_node_ && two_q.a1out_.empty());
+
+        delete hot_page;
+        for (const Page *page: pages) {
+            delete page;
+        }
+
+        return true;
+    }
+
+    static bool TestLruK() {
+        LruK lru_k(8);
+        const vector<Page *> pages = NewPages(3);
+        lru_k.Put(pages[1]->id_, pages[1]);
+        lru_k.Put(pages[2]->id_, pages[2]);
+        lru_k.Touch(pages[1]);
+        lru_k.Touch(pages[2]);
+
+        // Page 0 is read once, evicted before the pages read twice however recent its read
+        lru_k.Put(pages[0]->id_, pages[0]);
+        assert(lru_k.Victim() == pages[0]);
+        lru_k.EvictPage(pages[0]);
+        assert(lru_k.Victim() == pages[1]);
+
+        // Page 1 is read again, its second most recent read is now later than that of page 2
+        lru_k.Touch(pages[1]);
+        assert(lru_k.Victim() == pages[2]);
+
+        // Page 2 comes back soon after its eviction, its earlier read still counts
+        lru_k.EvictPage(pages[2]);
+        Page *page2 = new Page(pages[2]->id_);
+        page2->pin_count_ = 1;
+        lru_k.Put(page2->id_, page2);
+        assert(lru_k.Victim() == pages[1]);
+
+        // A pinned page is passed over
+        pages[1]->pin_count_ = 2;
+        assert(lru_k.Victim() == page2);
+
+        lru_k.Clear();
+        assert(lru_k.order_.empty() && !pages[1]->queue_node_ && !page2->queue_node_);
+
+        delete page2;
+        for (const Page *page: pages) {
+            delete page;
+        }
+
+        return true;
+    }
+
+    static bool TestEvictionPolicies() {
+        BufferPool *bufferPool =
+                new BufferPool(kMinShardPages * kPageSize * 2, kBufferPoolShards, EvictionPolicyType::kClock);
+        assert(bufferPool->shards_.size() == 2);
+
+        for (const auto policy_type: {EvictionPolicyType::kLRU, EvictionPolicyType::kClock, EvictionPolicyType::kTwoQ,
+                                      EvictionPolicyType::kLRUK}) {
+            bufferPool->SetEvictionPolicy(policy_type);
+            assert(bufferPool->Size() == 0);
+
+            // Pages read again and again among pages read once, the pool stays under its capacity
+            mt19937 gen(42);
+            for (int i = 0; i < 5000; i++) {
+                const uint32_t page_no = i % 2 == 0 ? gen() % 16 : 16 + i;
+                PageHandle page = bufferPool->Get(MakePageId(1, page_no));
+                if (!page) {
+                    page = bufferPool->Put(MakePageId(1, page_no), FullPage(page_no));
+                }
+                assert(page.Data()[1] == page_no);
+            }
+            assert(bufferPool->Bytes() <= bufferPool->capacity_);
+
+            // Almost every read of the 16 hot pages is a hit
+            assert(bufferPool->HitRate() > 0.4);
+            bufferPool->ResetStats();
+            assert(bufferPool->HitRate() == 0);
+        }
+
+        delete bufferPool;
+
+        return true;
+    }
+
+    static bool TestResize() {
+        BufferPool *bufferPool = new BufferPool(64 * kPageSize);
+        for (uint32_t i = 0; i < 48; i++) {
+            bufferPool->Put(MakePageId(1, i), FullPage(i));
+        }
+        assert(bufferPool->Size() == 48);
+        const PageHandle page0 = bufferPool->Get(MakePageId(1, 0));
+
+        // Shrinking evicts the least recently used pages right away, the pinned page stays
+        bufferPool->Resize(16 * kPageSize);
+        assert(bufferPool->capacity_ == 16 * kPageSize);
+        assert(bufferPool->Bytes() <= bufferPool->capacity_);
+        assert(bufferPool->Size() < 16);
+        assert(bufferPool->Get(MakePageId(1, 0)).Get() == page0.Get());
+        assert(bufferPool->Get(MakePageId(1, 47)));
+        assert(!bufferPool->Get(MakePageId(1, 1)));
+        assert(bufferPool->shards_[0]->frames_.NumSlots() == kMinFrameTableSlots);
+
+        // Growing keeps every page, the new budget is filled by the pages put next
+        const size_t num_pages = bufferPool->Size();
+        bufferPool->Resize(64 * kPageSize);
+        assert(bufferPool->Size() == num_pages);
+        for (uint32_t i = 100; i < 132; i++) {
+            bufferPool->Put(MakePageId(1, i), FullPage(i));
+        }
+        assert(bufferPool->Size() == num_pages + 32);
+        assert(bufferPool->Get(MakePageId(1, 47)));
+        assert(bufferPool->Bytes() <= bufferPool->capacity_);
+
+        delete bufferPool;
+
+        return true;
+    }
+
+    static bool TestScanRing() {
+        ScanRing ring(3);
+        assert(ring.Size() == 0);
+
+        // The ring holds the last 3 pages put, the oldest one is dropped first
+        for (int i = 1; i <= 4; i++) {
+            ring.Put(MakePageId(1, i), PageData(2, i));
+        }
+        assert(ring.Size() == 3);
+        assert(!ring.Get(MakePageId(1, 1)));
+        assert(ring.Get(MakePageId(1, 2)).Data()[0] == 2);
+        assert(ring.Get(MakePageId(1, 4)).Data()[0] == 4);
+
+        // The frame under the hand holds page 2, its buffer is taken over by the next page
+        const int64_t *buffer = ring.Get(MakePageId(1, 2)).Data().data();
+        PageData data = ring.TakeBuffer(2);
+        assert(data.data() == buffer);
+        assert(!ring.Get(MakePageId(1, 2)));
+        ring.Put(MakePageId(1, 5), std::move(data));
 
-        const Page *page = bufferPool->Get("test4");
+        // A page still read is not reused, it stays readable once out of the ring
+        const PageHandle page3 = ring.Get(MakePageId(1, 3));
+        data = ring.TakeBuffer(2);
+        assert(data.data() != page3.Data().data());
+        ring.Put(MakePageId(1, 6), std::move(data));
+        assert(!ring.Get(MakePageId(1, 3)));
+        assert(page3.Data()[0] == 3);
 
-        // Check if the pages in the LRU queue are in the correct order, page of name test4 should be the most recent
-        assert(bufferPool->eviction_policy_->rear_->page_ == page);
+        ring.Put(MakePageId(2, 1), PageData(2, 0));
+        ring.RemoveSst(1);
+        assert(ring.Size() == 1);
+        ring.Clear();
+        assert(ring.Size() == 0);
 
         return true;
     }
@@ -79,6 +508,17 @@ public:
         result &= AssertTrue(TestBuckets, "TestBufferPool::TestBuckets");
         result &= AssertTrue(TestLRU, "TestBufferPool::TestLRU");
         result &= AssertTrue(TestLRUEvict, "TestBufferPool::TestLRUEvict");
+        result &= AssertTrue(TestPinnedPage, "TestBufferPool::TestPinnedPage");
+        result &= AssertTrue(TestLRUQueueNode, "TestBufferPool::TestLRUQueueNode");
+        result &= AssertTrue(TestFrameTable, "TestBufferPool::TestFrameTable");
+        result &= AssertTrue(TestShards, "TestBufferPool::TestShards");
+        result &= AssertTrue(TestConcurrentAccess, "TestBufferPool::TestConcurrentAccess");
+        result &= AssertTrue(TestClock, "TestBufferPool::TestClock");
+        result &= AssertTrue(TestTwoQ, "TestBufferPool::TestTwoQ");
+        result &= AssertTrue(TestLruK, "TestBufferPool::TestLruK");
+        result &= AssertTrue(TestEvictionPolicies, "TestBufferPool::TestEvictionPolicies");
+        result &= AssertTrue(TestResize, "TestBufferPool::TestResize");
+        result &= AssertTrue(TestScanRing, "TestBufferPool::TestScanRing");
         return result;
     }
 };
@@ -4,7 +4,9 @@
 
 #include <cassert>
 
+#include "../include/buffer_pool/buffer_pool_manager.h"
 #include "../include/database.h"
+#include "../include/lsm_tree/lsm_tree.h"
 #include "../utils/log.h"
 #include "test_base.h"
 
@@ -69,10 +71,493 @@ class TestDb : public TestBase {
         return true;
     }
 
+    static bool TestDbMmap() {
+        Options options;
+        options.read_mode = ReadMode::kMmap;
+        Database db(32 * 1024, options); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+        for (auto i = 1; i <= 5000; ++i) {
+            db.Put(i, i * 10);
+        }
+        db.Close();
+
+        db.Open(db_name);
+        for (auto i = 900; i <= 1100; ++i) {
+            db.Put(i, -i * 100);
+        }
+        db.Close();
+
+        db.Open(db_name);
+
+        const optional<int64_t> value = db.Get(1024);
+        assert(value.has_value() && value.value() == -102400);
+        assert(db.Get(4096).value() == 40960);
+        assert(!db.Get(5001).has_value());
+
+        const auto res = db.Scan(1024, 4096);
+        assert(res.size() == 4096 - 1024 + 1);
+        assert(res.front().second == -102400);
+        assert(res.back().second == 40960);
+
+        // Pages are read from the mappings, nothing goes through the buffer pool
+        assert(BufferPoolManager::GetInstance()->Size() == 0);
+
+        db.Close();
+
+        return true;
+    }
+
+    static bool TestDbDirectIO() {
+        Options options;
+        options.read_mode = ReadMode::kDirectIO;
+        Database db(32 * 1024, options); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        // Enough keys for merges, whose reads and writes go through O_DIRECT too
+        db.Open(db_name);
+        for (auto i = 1; i <= 20000; ++i) {
+            db.Put(i, i * 10);
+        }
+        db.Close();
+
+        db.Open(db_name);
+        for (auto i = 900; i <= 1100; ++i) {
+            db.Put(i, -i * 100);
+        }
+        db.Close();
+
+        db.Open(db_name);
+        const auto buffer_pool = BufferPoolManager::GetInstance();
+        buffer_pool->Clear();
+
+        // Partial last leaves are padded on storage, only the key-value pairs are read back
+        assert(db.Get(1024).value() == -102400);
+        assert(db.Get(20000).value() == 200000);
+        assert(!db.Get(20001).has_value());
+
+        const auto res = db.Scan(1024, 4096);
+        assert(res.size() == 4096 - 1024 + 1);
+        assert(res.front().second == -102400);
+        assert(res.back().second == 40960);
+
+        // Pages read are cached by the buffer pool, their data aligned for the next direct reads
+        assert(buffer_pool->Size() > 0);
+        for (const auto shard: buffer_pool->shards_) {
+            shard->frames_.ForEach(
+                    [](const Page *page) { assert(reinterpret_cast<uintptr_t>(page->data_.data()) % kPageSize == 0); });
+        }
+
+        db.Close();
+
+        return true;
+    }
+
+    static bool TestDbLeafFormats() {
+        for (const auto read_mode: {ReadMode::kBufferPool, ReadMode::kMmap, ReadMode::kDirectIO}) {
+            Options options;
+            options.read_mode = read_mode;
+            options.leaf_formats = {LeafFormat::kColumnar, LeafFormat::kBitPacked, LeafFormat::kBitPacked};
+            Database db(32 * 1024, options); // 32KB
+            const string db_name = "test_db";
+            filesystem::remove_all(db_name);
+
+            // Enough keys for merges into the bit-packed levels, with tombstones and overwrites
+            db.Open(db_name);
+            for (auto i = 1; i <= 20000; ++i) {
+                db.Put(i, i * 10);
+            }
+            for (auto i = 900; i <= 1100; ++i) {
+                db.Put(i, -i * 100);
+            }
+            for (auto i = 3000; i <= 3100; ++i) {
+                db.Delete(i);
+            }
+            db.Close();
+
+            db.Open(db_name);
+            BufferPoolManager::GetInstance()->Clear();
+
+            // Level 0 is written columnar, the levels below bit-packed, with more pairs per leaf
+            const auto &levels = LsmTree::GetInstance().levelled_sst_;
+            assert(levels.size() > 1);
+            size_t num_packed_pairs = 0;
+            size_t num_packed_leaves = 0;
+            for (size_t level = 0; level < levels.size(); ++level) {
+                for (const auto sst: levels[level]) {
+                    assert(sst->leaf_format_ == (level == 0 ? LeafFormat::kColumnar : LeafFormat::kBitPacked));
+                    if (level > 0) {
+                        num_packed_pairs += sst->num_pairs_;
+                        for (const auto &node: sst->internal_nodes_) {
+                            num_packed_leaves += node.size();
+                        }
+                    }
+                }
+            }
+            assert(num_packed_pairs > 2 * kPagePairs * num_packed_leaves);
+
+            assert(db.Get(1024).value() == -102400);
+            assert(db.Get(20000).value() == 200000);
+            assert(!db.Get(3050).has_value());
+            assert(!db.Get(20001).has_value());
+
+            // Point lookups go through the search of the columnar keys
+            for (auto i = 2; i <= 20000; i += 97) {
+                if (i >= 3000 && i <= 3100) {
+                    assert(!db.Get(i).has_value());
+                    continue;
+                }
+                assert(db.Get(i).value() == (i >= 900 && i <= 1100 ? -i * 100 : i * 10));
+            }
+
+            const auto res = db.Scan(1, 20000);
+            assert(res.size() == 20000 - 101);
+            for (const auto &[key, value]: res) {
+                assert(value == (key >= 900 && key <= 1100 ? -key * 100 : key * 10));
+            }
+
+            db.Close();
+        }
+
+        return true;
+    }
+
+    static bool TestDbIterator() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+        for (auto i = 1; i <= 5000; ++i) {
+            db.Put(i, i * 10);
+        }
+        db.Close();
+
+        db.Open(db_name);
+        for (auto i = 2000; i <= 2100; ++i) {
+            db.Delete(i);
+        }
+        db.Put(2101, -1);
+
+        const auto iterator = db.NewIterator();
+        assert(!iterator->Valid());
+
+        // Deleted keys are hidden, the memtable hides the values in the SSTs
+        iterator->Seek(1990);
+        for (auto i = 1990; i < 2000; ++i) {
+            assert(iterator->Valid() && iterator->Key() == i && iterator->Value() == i * 10);
+            iterator->Next();
+        }
+        assert(iterator->Key() == 2101 && iterator->Value() == -1);
+
+        // Only the pages under the cursor are read
+        for (auto i = 2102; i < 2200; ++i) {
+            iterator->Next();
+            assert(iterator->Key() == i);
+        }
+        assert(BufferPoolManager::GetInstance()->Size() <= 2);
+
+        iterator->Seek(4999);
+        iterator->Next();
+        assert(iterator->Key() == 5000);
+        iterator->Next();
+        assert(!iterator->Valid());
+
+        delete iterator;
+
+        db.Close();
+
+        return true;
+    }
+
+    static bool TestBackgroundFlush() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+
+        // Full memtables are flushed and merged in the background while keys are read back
+        for (auto i = 1; i <= 20000; ++i) {
+            db.Put(i, i * 10);
+
+            if (i % 100 == 0) {
+                for (auto key = i - 99; key <= i; key += 33) {
+                    assert(db.Get(key).value() == key * 10);
+                }
+                assert(db.Get(i / 2).value() == i / 2 * 10);
+            }
+        }
+
+        // Newer values hide the flushed ones, wherever they are in the meantime
+        for (auto i = 1; i <= 20000; i += 2) {
+            db.Put(i, -i);
+        }
+        for (auto i = 1; i <= 20000; ++i) {
+            assert(db.Get(i).value() == (i % 2 == 1 ? -i : i * 10));
+        }
+
+        const auto res = db.Scan(9000, 11000);
+        assert(res.size() == 2001);
+        for (const auto &[key, value]: res) {
+            assert(value == (key % 2 == 1 ? -key : key * 10));
+        }
+
+        db.Close();
+
+        // Every memtable was flushed on close
+        db.Open(db_name);
+        for (auto i = 1; i <= 20000; ++i) {
+            assert(db.Get(i).value() == (i % 2 == 1 ? -i : i * 10));
+        }
+        db.Close();
+
+        return true;
+    }
+
+    static bool TestScanWhileWriting() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+
+        // Writers put every key twice, key * 10 then -key * 10, each of them its own keys
+        const int64_t num_keys = 8000;
+        atomic<size_t> num_writers_done = 0;
+        vector<thread> writers;
+        for (int64_t writer = 0; writer < 2; ++writer) {
+            writers.emplace_back([&, writer] {
+                for (const int64_t sign: {1, -1}) {
+                    for (int64_t key = 1 + writer; key <= num_keys; key += 2) {
+                        db.Put(key, sign * key * 10);
+                    }
+                }
+                ++num_writers_done;
+            });
+        }
+
+        // Scans and iterators see every key once, in order, with one of the values put
+        do {
+            int64_t last_key = 0;
+            for (const auto &[key, value]: db.Scan(1, num_keys)) {
+                assert(key > last_key);
+                assert(value == key * 10 || value == -key * 10);
+                last_key = key;
+            }
+
+            const auto iterator = db.NewIterator();
+            last_key = 0;
+            for (iterator->Seek(1); iterator->Valid(); iterator->Next()) {
+                assert(iterator->Key() > last_key);
+                assert(iterator->Value() == iterator->Key() * 10 || iterator->Value() == -iterator->Key() * 10);
+                last_key = iterator->Key();
+            }
+            delete iterator;
+        } while (num_writers_done < writers.size());
+
+        for (auto &writer: writers) {
+            writer.join();
+        }
+
+        const auto res = db.Scan(1, num_keys);
+        assert(res.size() == num_keys);
+        for (const auto &[key, value]: res) {
+            assert(value == -key * 10);
+        }
+
+        db.Close();
+
+        return true;
+    }
+
+    static bool TestIteratorWhileWriting() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+        for (auto i = 1; i <= 3000; ++i) {
+            db.Put(i, i * 10);
+        }
+
+        // The thread holding the iterator goes on writing, memtables are flushed and levels merged meanwhile
+        const auto iterator = db.NewIterator();
+        for (auto i = 1; i <= 20000; ++i) {
+            db.Put(i, -i);
+        }
+        assert(db.Get(1).value() == -1);
+
+        // The iterator reads the database as it was, from the SSTs merged away since
+        size_t num_keys = 0;
+        for (iterator->Seek(1); iterator->Valid(); iterator->Next()) {
+            assert(iterator->Key() == static_cast<int64_t>(++num_keys));
+            assert(iterator->Value() == iterator->Key() * 10);
+        }
+        assert(num_keys == 3000);
+        delete iterator;
+
+        db.Close();
+
+        // Merged SSTs are deleted with the iterator, only the merged data is opened again
+        db.Open(db_name);
+        const auto res = db.Scan(1, 20000);
+        assert(res.size() == 20000);
+        for (const auto &[key, value]: res) {
+            assert(value == -key);
+        }
+        db.Close();
+
+        return true;
+    }
+
+    static bool TestWriteBatch() {
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        {
+            Database db(32 * 1024); // 32KB, 2048 key-value pairs per memtable
+            db.Open(db_name);
+
+            // The batch is larger than the memtable, it is flushed once the whole batch is in it
+            WriteBatch batch;
+            for (auto i = 1; i <= 5000; ++i) {
+                batch.Put(i, i * 10);
+            }
+            for (auto i = 1; i <= 5000; i += 2) {
+                batch.Delete(i);
+            }
+            batch.Put(1, -1);
+            assert(batch.Count() == 7501);
+            db.Write(batch);
+
+            assert(db.Get(1).value() == -1);
+            for (auto i = 2; i <= 5000; ++i) {
+                assert(db.Get(i) == (i % 2 == 1 ? nullopt : optional<int64_t>(i * 10)));
+            }
+            db.Close();
+
+            LsmTree &lsm_tree = LsmTree::GetInstance();
+            assert(lsm_tree.levelled_sst_.size() == 1);
+            assert(lsm_tree.levelled_sst_[0].size() == 1);
+
+            // A batch is one record of the log, it is replayed as a whole when the database is not closed
+            db.Open(db_name);
+            batch.Clear();
+            for (auto i = 1; i <= 1000; ++i) {
+                batch.Put(i, i);
+            }
+            db.Write(batch);
+        }
+
+        Database db(32 * 1024);
+        db.Open(db_name);
+        for (auto i = 1; i <= 5000; ++i) {
+            const auto value = db.Get(i);
+            if (i <= 1000) {
+                assert(value.value() == i);
+            } else {
+                assert(value == (i % 2 == 1 ? nullopt : optional<int64_t>(i * 10)));
+            }
+        }
+        db.Close();
+
+        return true;
+    }
+
+    static bool TestMultiGet() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+
+        // Keys are spread over the memtables and SSTs of several levels, some overwritten or deleted
+        for (auto i = 1; i <= 20000; ++i) {
+            db.Put(i, i * 10);
+        }
+        for (auto i = 1; i <= 20000; i += 3) {
+            db.Put(i, -i);
+        }
+        for (auto i = 2; i <= 20000; i += 7) {
+            db.Delete(i);
+        }
+
+        // Unsorted, with duplicates and missing keys
+        vector<int64_t> keys;
+        for (auto i = 0; i < 2000; ++i) {
+            keys.push_back(i * 7919 % 25000);
+        }
+        keys.push_back(keys.front());
+
+        const auto values = db.MultiGet(keys);
+        assert(values.size() == keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            assert(values[i] == db.Get(keys[i]));
+        }
+        db.Close();
+
+        return true;
+    }
+
+    static bool TestScanRing() {
+        Database db(1024 * 1024); // 1MB, the keys fit in one memtable
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        // Sparse keys, 100 leaves in one SST
+        db.Open(db_name);
+        WriteBatch batch;
+        for (auto i = 0; i < 100 * static_cast<int>(kPagePairs); ++i) {
+            batch.Put(i * 1000, i);
+        }
+        db.Write(batch);
+        db.Close();
+        db.Open(db_name);
+
+        const auto buffer_pool = BufferPoolManager::GetInstance();
+        buffer_pool->Clear();
+        assert(db.Get(5000).value() == 5);
+        assert(buffer_pool->Size() == 1);
+
+        // The range spans millions of keys but only 10 leaves, the pages read are cached
+        auto result = db.Scan(0, 10 * static_cast<int64_t>(kPagePairs) * 1000 - 1);
+        assert(result.size() == 10 * kPagePairs);
+        const size_t num_cached = buffer_pool->Size();
+        assert(num_cached >= 10 && num_cached <= 12);
+
+        // The whole SST goes through the scan ring, the cached pages are left in place
+        result = db.Scan(INT64_MIN, INT64_MAX);
+        assert(result.size() == 100 * kPagePairs);
+        assert(buffer_pool->Size() == num_cached);
+        assert(buffer_pool->scan_ring_.Size() == kScanRingPages);
+
+        buffer_pool->ResetStats();
+        assert(db.Get(5000).value() == 5);
+        assert(buffer_pool->HitRate() == 1);
+
+        db.Close();
+
+        return true;
+    }
+
 public:
     bool RunTests() override {
         bool result = true;
         result &= AssertTrue(TestDbIntegrated, "TestDb::TestDbIntegrated");
+        result &= AssertTrue(TestDbMmap, "TestDb::TestDbMmap");
+        result &= AssertTrue(TestDbDirectIO, "TestDb::TestDbDirectIO");
+        result &= AssertTrue(TestDbLeafFormats, "TestDb::TestDbLeafFormats");
+        result &= AssertTrue(TestDbIterator, "TestDb::TestDbIterator");
+        result &= AssertTrue(TestBackgroundFlush, "TestDb::TestBackgroundFlush");
+        result &= AssertTrue(TestScanWhileWriting, "TestDb::TestScanWhileWriting");
+        result &= AssertTrue(TestIteratorWhileWriting, "TestDb::TestIteratorWhileWriting");
+        result &= AssertTrue(TestWriteBatch, "TestDb::TestWriteBatch");
+        result &= AssertTrue(TestMultiGet, "TestDb::TestMultiGet");
+        result &= AssertTrue(TestScanRing, "TestDb::TestScanRing");
         return result;
     }
 };
@@ -0,0 +1,175 @@
+//
+// Created by Kiiro Huang on 2024-12-05.
+//
+
+#include <cassert>
+
+#include "../include/b_tree/b_tree_sstable.h"
+#include "../include/database.h"
+#include "../include/merging_iterator.h"
+#include "../include/sstable_iterator.h"
+#include "test_base.h"
+
+class TestIterator : public TestBase {
+    static bool TestSSTableIterator() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+
+        const auto sst = new BTreeSSTable(db_name, true);
+        vector<int64_t> data;
+        for (auto i = 1; i <= 1000; ++i) {
+            data.push_back(i * 2);
+            data.push_back(i * 20);
+        }
+        sst->FlushToStorage(&data);
+
+        {
+            SSTableIterator iterator(sst);
+
+            // Seek to a missing key lands on the next key, across pages
+            iterator.Seek(511);
+            assert(iterator.Valid() && iterator.Key() == 512 && iterator.Value() == 5120);
+
+            int64_t expected = 512;
+            for (; iterator.Valid(); iterator.Next()) {
+                assert(iterator.Key() == expected);
+                expected += 2;
+            }
+            assert(expected == 2002);
+
+            iterator.Seek(-100);
+            assert(iterator.Valid() && iterator.Key() == 2);
+
+            iterator.Seek(2001);
+            assert(!iterator.Valid());
+        }
+
+        delete sst;
+
+        return true;
+    }
+
+    static bool TestMergingIterator() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+
+        const auto older = new BTreeSSTable(db_name, true);
+        const auto newer = new BTreeSSTable(db_name, true);
+
+        vector<int64_t> data;
+        for (auto i = 1; i <= 3000; ++i) {
+            data.push_back(i);
+            data.push_back(i * 10);
+        }
+        older->FlushToStorage(&data);
+
+        data.clear();
+        for (auto i = 1000; i <= 2000; ++i) {
+            data.push_back(i);
+            data.push_back(i == 1500 ? INT64_MIN : -i);
+        }
+        newer->FlushToStorage(&data);
+
+        Memtable memtable(32 * 1024);
+        memtable.Put(1999, 0);
+        memtable.Put(5000, 1);
+
+        // Iterators pin pages of the SSTs, they go out of scope before the SSTs are deleted
+        {
+            // Children from the newest to the oldest
+            MergingIterator iterator({memtable.NewIterator(), new SSTableIterator(newer), new SSTableIterator(older)});
+
+            int64_t expected = 900;
+            for (iterator.Seek(900); iterator.Valid(); iterator.Next()) {
+                const int64_t key = iterator.Key();
+                assert(key == expected);
+
+                if (key == 5000) {
+                    assert(iterator.Value() == 1);
+                } else if (key == 1999) {
+                    assert(iterator.Value() == 0);
+                } else if (key == 1500) {
+                    // Tombstones are yielded, hiding the older value
+                    assert(iterator.Value() == INT64_MIN);
+                } else if (key >= 1000 && key <= 2000) {
+                    assert(iterator.Value() == -key);
+                } else {
+                    assert(iterator.Value() == key * 10);
+                }
+
+                expected = key == 3000 ? 5000 : key + 1;
+            }
+            assert(expected == 5001);
+        }
+
+        delete older;
+        delete newer;
+
+        return true;
+    }
+
+public:
+    static bool TestMemtableIterator() {
+        Memtable memtable(32 * 1024);
+        for (auto i = 0; i < 100; i += 2) {
+            memtable.Put(i, i);
+        }
+
+        // Puts go on while the iterator is held, it keeps seeing the memtable as it was
+        const auto iterator = memtable.NewIterator();
+        iterator->Seek(10);
+        for (auto i = 0; i < 100; ++i) {
+            // Overwrites keys ahead of and behind the cursor, and puts keys in between
+            memtable.Put(i, -i);
+            if (i % 2 == 0) {
+                memtable.Delete(i + 20);
+            }
+        }
+
+        int64_t expected = 10;
+        for (; iterator->Valid(); iterator->Next()) {
+            assert(iterator->Key() == expected);
+            assert(iterator->Value() == expected);
+            memtable.Put(expected + 1, 1);
+            expected += 2;
+        }
+        assert(expected == 100);
+        delete iterator;
+
+        // New reads see the newest values, older versions are kept for the iterator only
+        const auto newest = memtable.NewIterator();
+        expected = 0;
+        for (newest->Seek(0); newest->Valid(); newest->Next()) {
+            assert(newest->Key() == expected);
+            const int64_t value = expected >= 100 ? INT64_MIN : expected % 2 == 1 && expected >= 11 ? 1 : -expected;
+            assert(newest->Value() == value);
+            assert(memtable.Get(expected) == value);
+            expected += expected < 100 ? 1 : 2;
+        }
+        assert(expected == 120);
+        delete newest;
+
+        const auto pairs = memtable.Traverse();
+        assert(pairs.size() == 110 * 2);
+        for (size_t i = 0; i < pairs.size(); i += 2) {
+            assert(i == 0 || pairs[i - 2] < pairs[i]);
+            assert(pairs[i + 1] == memtable.Get(pairs[i]));
+        }
+
+        return true;
+    }
+
+    bool RunTests() override {
+        bool result = true;
+        result &= AssertTrue(TestSSTableIterator, "TestIterator::TestSSTableIterator");
+        result &= AssertTrue(TestMergingIterator, "TestIterator::TestMergingIterator");
+        result &= AssertTrue(TestMemtableIterator, "TestIterator::TestMemtableIterator");
+        return result;
+    }
+};
@@ -0,0 +1,101 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#include <algorithm>
+#include <cassert>
+#include <random>
+
+#include "../include/leaf_page.h"
+#include "test_base.h"
+
+class TestLeafPage : public TestBase {
+    // Checks every search of a page of the sorted keys against std::lower_bound and std::upper_bound
+    static void CheckSearches(const vector<int64_t> &keys, const bool is_columnar) {
+        PageData interleaved;
+        for (const auto key: keys) {
+            interleaved.push_back(key);
+            interleaved.push_back(~key);
+        }
+        const PageData data = is_columnar ? LeafPage::ToColumnar(interleaved) : interleaved;
+        const LeafPage leaf(data, is_columnar);
+        assert(leaf.NumPairs() == keys.size());
+
+        vector<int64_t> targets = {INT64_MIN, INT64_MIN + 1, INT64_MAX - 1, INT64_MAX};
+        for (const auto key: keys) {
+            targets.push_back(key);
+            if (key > INT64_MIN) {
+                targets.push_back(key - 1);
+            }
+            if (key < INT64_MAX) {
+                targets.push_back(key + 1);
+            }
+        }
+        for (const auto target: targets) {
+            const size_t lower = ranges::lower_bound(keys, target) - keys.begin();
+            const size_t upper = ranges::upper_bound(keys, target) - keys.begin();
+            assert(leaf.LowerBound(target) == lower);
+            assert(leaf.UpperBound(target) == upper);
+
+            // The search may start past keys already known to be smaller
+            assert(leaf.LowerBound(target, lower / 2) == lower);
+            assert(leaf.LowerBound(target, keys.size()) == keys.size());
+
+            const auto value = leaf.Find(target);
+            assert(value.has_value() == (lower < upper));
+            assert(!value || value.value() == ~target);
+        }
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            assert(leaf.Key(i) == keys[i]);
+            assert(leaf.Value(i) == ~keys[i]);
+        }
+    }
+
+    static bool TestSearch() {
+        mt19937_64 rng(42);
+        for (const size_t num_keys: {0, 1, 2, 3, 4, 5, 15, 16, 17, 31, 33, 100, 255, 256, 1023, 1024}) {
+            // Dense keys, sparse keys over the whole range of int64_t
+            vector<int64_t> dense(num_keys);
+            for (size_t i = 0; i < num_keys; ++i) {
+                dense[i] = static_cast<int64_t>(i) * 2 - 100;
+            }
+
+            vector<int64_t> sparse(num_keys);
+            for (auto &key: sparse) {
+                key = static_cast<int64_t>(rng());
+            }
+            if (num_keys > 1) {
+                sparse[0] = INT64_MIN;
+                sparse[1] = INT64_MAX;
+            }
+            ranges::sort(sparse);
+            sparse.erase(ranges::unique(sparse).begin(), sparse.end());
+
+            for (const bool is_columnar: {false, true}) {
+                CheckSearches(dense, is_columnar);
+                CheckSearches(sparse, is_columnar);
+            }
+        }
+
+        // The search picked for this CPU is one of the known ones
+        const string name = LeafPage::SearchName();
+        assert(name == "avx2" || name == "sse4.2" || name == "neon" || name == "scalar");
+        return true;
+    }
+
+    static bool TestToColumnar() {
+        const PageData columnar = LeafPage::ToColumnar(PageData{1, 10, 2, 20, 3, 30});
+        assert((columnar == PageData{1, 2, 3, 10, 20, 30}));
+        assert(LeafPage::ToColumnar(PageData()).empty());
+        return true;
+    }
+
+public:
+    bool RunTests() override {
+        bool result = true;
+        result &= AssertTrue(TestSearch, "TestLeafPage::TestSearch");
+        result &= AssertTrue(TestToColumnar, "TestLeafPage::TestToColumnar");
+        return result;
+    }
+};
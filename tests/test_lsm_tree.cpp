@@ -41,25 +41,86 @@ class TestLsmTree : public TestBase {
         }
         c->FlushToStorage(&data);
 
+        // Merge into a new SST, leaf pages are written as the merge goes
         auto &lsm_tree = LsmTree::GetInstance();
-        const auto result = lsm_tree.SortMerge(new vector{a, b, c}, true);
+        const auto merged = new BTreeSSTable(db_name, true, 1);
+        BTreeSSTableBuilder builder(merged, 5000 + 201 + 501);
+        lsm_tree.SortMerge(new vector{a, b, c}, true, &builder);
+        builder.Finish();
+        assert(builder.NumPairs() == 5000);
 
-        assert(result.size() == 10000);
-        assert(result[0] == 1);
-        assert(result[1] == 10);
+        const auto result = merged->Scan(1, 5000);
+        assert(result.size() == 5000);
+        assert(result[0].first == 1 && result[0].second == 10);
 
-        assert(result[798] == 400);
-        assert(result[799] == 40000);
+        assert(result[399].first == 400 && result[399].second == 40000);
 
-        assert(result[998] == 500);
-        assert(result[999] == -500);
+        assert(result[499].first == 500 && result[499].second == -500);
 
-        assert(result[9998] == 5000);
-        assert(result[9999] == 50000);
+        assert(result[4999].first == 5000 && result[4999].second == 50000);
 
         delete a;
         delete b;
         delete c;
+        delete merged;
+
+        return true;
+    }
+
+    static bool TestMergeDisposeTombstone() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+
+        const auto older = new BTreeSSTable(db_name, true);
+        const auto newer = new BTreeSSTable(db_name, true);
+
+        vector<int64_t> data;
+        for (auto i = 1; i <= 1000; i++) {
+            data.push_back(i);
+            data.push_back(i * 10);
+        }
+        older->FlushToStorage(&data);
+
+        // Even keys up to 200 are deleted
+        data.clear();
+        for (auto i = 2; i <= 200; i += 2) {
+            data.push_back(i);
+            data.push_back(INT64_MIN);
+        }
+        newer->FlushToStorage(&data);
+
+        auto &lsm_tree = LsmTree::GetInstance();
+        const auto merged = new BTreeSSTable(db_name, true, 1);
+        BTreeSSTableBuilder builder(merged, 1000 + 100);
+        lsm_tree.SortMerge(new vector{older, newer}, true, &builder);
+        const string file_path = builder.Finish();
+
+        // The tombstones are dropped along with the older pairs they hide, every other pair is kept
+        assert(builder.NumPairs() == 900);
+
+        // Index pages were reserved for 1100 pairs, the SST reads back the same
+        const auto reopened = new BTreeSSTable(file_path, false);
+        assert(reopened->root_ == merged->root_);
+        assert(reopened->internal_nodes_ == merged->internal_nodes_);
+        assert(reopened->min_key_ == 1);
+        assert(reopened->max_key_ == 1000);
+
+        for (auto i = 1; i <= 1000; i++) {
+            if (i <= 200 && i % 2 == 0) {
+                assert(!reopened->Get(i).has_value());
+            } else {
+                assert(reopened->Get(i).value() == i * 10);
+            }
+        }
+        assert(reopened->Scan(1, 1000).size() == 900);
+
+        delete older;
+        delete newer;
+        delete merged;
+        delete reopened;
 
         return true;
     }
@@ -106,12 +167,101 @@ class TestLsmTree : public TestBase {
         return true;
     }
 
+    static bool TestBackgroundCompaction() {
+        Options options;
+        options.max_background_compactions = 3;
+        Database db(4 * 1024, options); // 4KB, 256 key-value pairs per memtable
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        // Keys are written over and over, levels 0 to 2 are merged concurrently
+        db.Open(db_name);
+        map<int64_t, int64_t> expected;
+        for (auto i = 1; i <= 100000; ++i) {
+            const int64_t key = i * 7919 % 6000;
+            db.Put(key, i);
+            expected[key] = i;
+        }
+        for (auto key = 0; key < 6000; key += 5) {
+            db.Delete(key);
+            expected.erase(key);
+        }
+        db.Close();
+
+        // Every full level has been merged on close
+        LsmTree &lsm_tree = LsmTree::GetInstance();
+        assert(lsm_tree.levelled_sst_.size() >= 3);
+        for (int64_t level = 0; level < static_cast<int64_t>(lsm_tree.levelled_sst_.size()); ++level) {
+            assert(!lsm_tree.NeedsMerge(level));
+        }
+
+        // Level 2 holds more than 10 SSTs, they are reopened in the order they were created
+        db.Open(db_name);
+        for (auto key = 0; key < 6000; ++key) {
+            const auto value = db.Get(key);
+            if (expected.contains(key)) {
+                assert(value.has_value() && value.value() == expected[key]);
+            } else {
+                assert(!value.has_value());
+            }
+        }
+        db.Close();
+
+        return true;
+    }
+
+    static bool TestSubcompaction() {
+        Options options;
+        options.max_subcompactions = 4;
+        Database db(512 * 1024, options); // 512KB, 128 leaves per memtable
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        // 3 memtables fill level 0, their 384 leaves are merged in 4 sub-ranges
+        db.Open(db_name);
+        for (auto i = 0; i < 3 * 32768; ++i) {
+            db.Put(i * 7919 % 98304, i);
+        }
+        for (auto key = 0; key < 98304; key += 3) {
+            db.Delete(key);
+        }
+        db.Close();
+
+        db.Open(db_name);
+
+        // Level 1 holds one run of 4 SSTs with disjoint key ranges, it is far from full
+        LsmTree &lsm_tree = LsmTree::GetInstance();
+        assert(lsm_tree.levelled_sst_.size() >= 2);
+        const auto &level = lsm_tree.levelled_sst_[1];
+        assert(level.size() == 4);
+        assert(lsm_tree.NumRuns(1) == 1);
+        for (size_t i = 1; i < level.size(); ++i) {
+            assert(level[i]->run_ == level[0]->run_);
+            assert(level[i - 1]->max_key_ < level[i]->min_key_);
+        }
+
+        for (auto key = 0; key < 98304; ++key) {
+            const auto value = db.Get(key);
+            if (key % 3 == 0) {
+                assert(!value.has_value());
+            } else {
+                assert(value.has_value() && value.value() * 7919 % 98304 == key);
+            }
+        }
+        db.Close();
+
+        return true;
+    }
+
 public:
     bool RunTests() override {
         bool result = true;
         result &= AssertTrue(TestMultipleMergeSort, "TestLsmTree::TestMultipleMergeSort");
+        result &= AssertTrue(TestMergeDisposeTombstone, "TestLsmTree::TestMergeDisposeTombstone");
         result &= AssertTrue(TestBuildLsmTree, "TestLsmTree::TestBuildLsmTree");
         result &= AssertTrue(TestLsmTreeIntegrated, "TestLsmTree::TestLsmTreeIntegrated");
+        result &= AssertTrue(TestBackgroundCompaction, "TestLsmTree::TestBackgroundCompaction");
+        result &= AssertTrue(TestSubcompaction, "TestLsmTree::TestSubcompaction");
         return result;
     }
 };
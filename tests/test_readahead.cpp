@@ -0,0 +1,100 @@
+//
+// Created by Kiiro Huang on 2024-12-09.
+//
+
+#include <cassert>
+
+#include "../include/b_tree/b_tree_sstable.h"
+#include "../include/buffer_pool/buffer_pool_manager.h"
+#include "../include/database.h"
+#include "../include/readahead.h"
+#include "test_base.h"
+
+class TestReadahead : public TestBase {
+    // 200 full leaves of keys 1 to 51200, values 10 times the keys
+    static BTreeSSTable *NewSst(const string &db_name) {
+        const auto sst = new BTreeSSTable(db_name, true);
+        vector<int64_t> data;
+        for (auto i = 1; i <= 200 * static_cast<int>(kPagePairs); ++i) {
+            data.push_back(i);
+            data.push_back(i * 10);
+        }
+        sst->FlushToStorage(&data);
+        return sst;
+    }
+
+    static bool TestReadPages() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+        db.Open(db_name);
+
+        const auto sst = NewSst(db_name);
+        BufferPoolManager::GetInstance()->Clear();
+
+        // The cached page splits the pages to read into two runs
+        const auto cached_page = sst->GetPage(sst->leaf_start_offset_ + 2 * kPageSize);
+        const auto pages = sst->ReadPages(sst->leaf_start_offset_, 5);
+        assert(pages.size() == 5);
+        assert(pages[2].Data().data() == cached_page.Data().data());
+        for (size_t i = 0; i < pages.size(); ++i) {
+            assert(pages[i].GetSize() == kPagePairs * 2);
+            assert(pages[i].Data()[0] == static_cast<int64_t>(i * kPagePairs + 1));
+            assert(pages[i].Data()[kPagePairs * 2 - 1] == static_cast<int64_t>((i + 1) * kPagePairs * 10));
+        }
+
+        // Fewer pages past the last one
+        assert(sst->ReadPages(sst->leaf_end_offset_ - 2 * kPageSize, 5).size() == 2);
+        assert(sst->ReadPages(sst->leaf_end_offset_, 5).empty());
+
+        delete sst;
+        return true;
+    }
+
+    static bool TestWindow() {
+        Database db(32 * 1024); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+        db.Open(db_name);
+
+        const auto sst = NewSst(db_name);
+        BufferPoolManager::GetInstance()->Clear();
+
+        // The window doubles every time the cursor uses it up
+        Readahead readahead(sst, true, sst->leaf_end_offset_);
+        vector<size_t> windows;
+        for (size_t leaf = 0; leaf < 200; ++leaf) {
+            const auto page = readahead.GetPage(sst->leaf_start_offset_ + leaf * kPageSize);
+            assert(page.Data()[0] == static_cast<int64_t>(leaf * kPagePairs + 1));
+            if (windows.empty() || windows.back() != readahead.WindowPages()) {
+                windows.push_back(readahead.WindowPages());
+            }
+        }
+        assert((windows == vector<size_t>{4, 8, 16, 32, 64}));
+        assert(!readahead.GetPage(sst->leaf_end_offset_));
+
+        // A page out of order starts over from the smallest window
+        assert(readahead.GetPage(sst->leaf_start_offset_).Data()[0] == 1);
+        assert(readahead.WindowPages() == kReadaheadMinPages);
+
+        // Nothing is read ahead past the end offset, the pages there are read one at a time
+        BufferPoolManager::GetInstance()->Clear();
+        Readahead bounded(sst, true, sst->leaf_start_offset_ + 2 * kPageSize);
+        assert(bounded.GetPage(sst->leaf_start_offset_));
+        assert(bounded.GetPage(sst->leaf_start_offset_ + kPageSize));
+        assert(BufferPoolManager::GetInstance()->scan_ring_.Size() == 2);
+        assert(bounded.GetPage(sst->leaf_start_offset_ + 2 * kPageSize).Data()[0] ==
+               static_cast<int64_t>(2 * kPagePairs + 1));
+
+        delete sst;
+        return true;
+    }
+
+public:
+    bool RunTests() override {
+        bool result = true;
+        result &= AssertTrue(TestReadPages, "TestReadahead::TestReadPages");
+        result &= AssertTrue(TestWindow, "TestReadahead::TestWindow");
+        return result;
+    }
+};
@@ -4,10 +4,18 @@
 
 #include <iostream>
 
+#include "test_async_reader.cpp"
 #include "test_b_tree.cpp"
 #include "test_base.h"
+#include "test_bit_packed_leaf.cpp"
+#include "test_bloom_filter.cpp"
 #include "test_buffer_pool.cpp"
+#include "test_iterator.cpp"
+#include "test_leaf_page.cpp"
 #include "test_lsm_tree.cpp"
+#include "test_readahead.cpp"
+#include "test_table_cache.cpp"
+#include "test_write_ahead_log.cpp"
 #include "test_db.cpp"
 
 using namespace std;
@@ -16,7 +24,15 @@ int main() {
     vector<std::pair<TestBase *, string>> testClasses = {
             make_pair(new TestBufferPool(), "TestBufferPool"),
             make_pair(new TestBTree(), "TestBTree"),
+            make_pair(new TestBloomFilter(), "TestBloomFilter"),
+            make_pair(new TestBitPackedLeaf(), "TestBitPackedLeaf"),
+            make_pair(new TestIterator(), "TestIterator"),
+            make_pair(new TestLeafPage(), "TestLeafPage"),
             make_pair(new TestLsmTree(), "TestLsmTree"),
+            make_pair(new TestTableCache(), "TestTableCache"),
+            make_pair(new TestWriteAheadLog(), "TestWriteAheadLog"),
+            make_pair(new TestAsyncReader(), "TestAsyncReader"),
+            make_pair(new TestReadahead(), "TestReadahead"),
             make_pair(new TestDb(), "TestDb"),
     };
 
@@ -0,0 +1,66 @@
+//
+// Created by Kiiro Huang on 2024-12-04.
+//
+
+#include <cassert>
+
+#include "../include/b_tree/b_tree_sstable.h"
+#include "../include/buffer_pool/buffer_pool_manager.h"
+#include "../include/database.h"
+#include "../include/table_cache.h"
+#include "test_base.h"
+
+class TestTableCache : public TestBase {
+    static bool TestMaxOpenFiles() {
+        Options options;
+        options.max_open_files = 2;
+        Database db(32 * 1024, options); // 32KB
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        db.Open(db_name);
+
+        vector<BTreeSSTable *> ssts;
+        for (auto n = 0; n < 3; ++n) {
+            const auto sst = new BTreeSSTable(db_name, true);
+            vector<int64_t> data;
+            for (auto i = 1; i <= 1024; ++i) {
+                data.push_back(i);
+                data.push_back(i * 10 + n);
+            }
+            sst->FlushToStorage(&data);
+            ssts.push_back(sst);
+        }
+
+        // Only the 2 most recently used SSTs keep their file open
+        assert(TableCache::GetInstance().Size() == 2);
+        assert(ssts[0]->fd_ == -1);
+        assert(ssts[1]->fd_ >= 0 && ssts[2]->fd_ >= 0);
+
+        // A closed SST is reopened on read, closing the least recently used one
+        BufferPoolManager::GetInstance()->Clear();
+        assert(ssts[0]->Get(512).value() == 5120);
+        assert(ssts[0]->fd_ >= 0);
+        assert(ssts[1]->fd_ == -1);
+
+        // Later reads keep using the open file
+        const int fd = ssts[0]->fd_;
+        BufferPoolManager::GetInstance()->Clear();
+        assert(ssts[0]->Get(1024).value() == 10240);
+        assert(ssts[0]->fd_ == fd);
+
+        for (const auto sst: ssts) {
+            delete sst;
+        }
+        assert(TableCache::GetInstance().Size() == 0);
+
+        return true;
+    }
+
+public:
+    bool RunTests() override {
+        bool result = true;
+        result &= AssertTrue(TestMaxOpenFiles, "TestTableCache::TestMaxOpenFiles");
+        return result;
+    }
+};
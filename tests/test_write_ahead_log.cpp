@@ -0,0 +1,123 @@
+//
+// Created by Kiiro Huang on 2024-12-07.
+//
+
+#include <cassert>
+#include <thread>
+
+#include "../include/database.h"
+#include "../include/write_ahead_log.h"
+#include "test_base.h"
+
+class TestWriteAheadLog : public TestBase {
+    static bool TestReplayAfterCrash() {
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        // The database is destroyed without being closed, its memtable is not flushed
+        {
+            Database db(32 * 1024); // 32KB
+            db.Open(db_name);
+            for (auto i = 1; i <= 5000; ++i) {
+                db.Put(i, i * 10);
+            }
+            for (auto i = 1; i <= 5000; i += 2) {
+                db.Delete(i);
+            }
+        }
+
+        // The writes left in the memtables are replayed into level 0, then the logs are removed
+        Database db(32 * 1024);
+        db.Open(db_name);
+        assert(WriteAheadLog::ListLogs(db_name) == vector<int64_t>({0}));
+        for (auto i = 1; i <= 5000; ++i) {
+            const auto value = db.Get(i);
+            if (i % 2 == 1) {
+                assert(!value.has_value());
+            } else {
+                assert(value.has_value() && value.value() == i * 10);
+            }
+        }
+        db.Close();
+
+        return true;
+    }
+
+    static bool TestTornRecord() {
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+        filesystem::create_directory(db_name);
+
+        {
+            WriteAheadLog wal(db_name, 0, WalSyncMode::kNever, kWalSyncIntervalMs);
+            wal.Append({{1, 10}, {2, 20}});
+            wal.Append({{3, 30}});
+            wal.Append({{4, 40}, {5, 50}});
+        }
+        const string file_path = db_name + "/wal_0.log";
+        assert(WriteAheadLog::ReadLog(db_name, 0).size() == 5);
+
+        // The last record is cut short by a crash, only the records before it are replayed
+        filesystem::resize_file(file_path, filesystem::file_size(file_path) - sizeof(int64_t));
+        const vector<pair<int64_t, int64_t>> first_records = {{1, 10}, {2, 20}, {3, 30}};
+        assert(WriteAheadLog::ReadLog(db_name, 0) == first_records);
+
+        // A record whose checksum does not match ends the log as well
+        {
+            fstream file(file_path, ios::in | ios::out | ios::binary);
+            const int64_t value = 31;
+            file.seekp(8 * sizeof(int64_t));
+            file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+        const vector<pair<int64_t, int64_t>> first_record = {{1, 10}, {2, 20}};
+        assert(WriteAheadLog::ReadLog(db_name, 0) == first_record);
+
+        return true;
+    }
+
+    static bool TestGroupCommit() {
+        const string db_name = "test_db";
+        filesystem::remove_all(db_name);
+
+        // Concurrent writers share writes and syncs of the log
+        {
+            Options options;
+            options.wal_sync_mode = WalSyncMode::kEveryWrite;
+            Database db(32 * 1024, options); // 32KB
+            db.Open(db_name);
+
+            vector<thread> writers;
+            for (auto t = 0; t < 8; ++t) {
+                writers.emplace_back([&db, t] {
+                    for (auto i = 0; i < 500; ++i) {
+                        db.Put(t * 500 + i, i);
+                    }
+                });
+            }
+            for (auto &writer: writers) {
+                writer.join();
+            }
+        }
+
+        Database db(32 * 1024);
+        db.Open(db_name);
+        for (auto t = 0; t < 8; ++t) {
+            for (auto i = 0; i < 500; ++i) {
+                const auto value = db.Get(t * 500 + i);
+                assert(value.has_value() && value.value() == i);
+            }
+        }
+        db.Close();
+
+        return true;
+    }
+
+public:
+    bool RunTests() override {
+        bool result = true;
+        result &= AssertTrue(TestReplayAfterCrash, "TestWriteAheadLog::TestReplayAfterCrash");
+        result &= AssertTrue(TestTornRecord, "TestWriteAheadLog::TestTornRecord");
+        result &= AssertTrue(TestGroupCommit, "TestWriteAheadLog::TestGroupCommit");
+        return result;
+    }
+};
@@ -4,6 +4,8 @@
 
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
+#include <cstddef>
+#include <cstdint>
 
 //------------ Page ------------
 
@@ -39,22 +41,86 @@ inline constexpr size_t kPageNum = kMemtableSize / kPageSize; // 256
 // inline constexpr size_t kBufferPoolSize = kMemtableSize; // 32KB
 
 // This parameter is for experiment
+// The budget counts the bytes of the cached pages, of their frames and of the metadata of the eviction policy
+// Pages are evicted as soon as the next one would not fit
 inline constexpr size_t kBufferPoolSize = 10 * 1024 * 1024; // 10MB
 
-// When buffer pool reaches 80% of its capacity, it will evict some pages
-inline constexpr double kCoeffBufferPool = 0.8;
-
-// When the key range of a scan covers over 0.25 * 8 = 2 pages, apply sequential flooding
-// The pages covered during this scan will not be put into buffer pool
+// When a scan is estimated from the B-Tree index to read over 0.25 * 256 = 64 leaves, apply sequential flooding
+// The pages read by this scan, like those read by merges, go through the scan ring instead of the buffer pool
 inline constexpr double kCoeffSequentialFlooding = 0.25;
 inline constexpr double kPageSequentialFlooding = kCoeffSequentialFlooding * kPageNum;
 
+// The scan ring reuses 32 frames (128KB) for the pages of large scans and merges
+inline constexpr size_t kScanRingPages = 32;
+
+// The buffer pool is split into up to 16 shards, each with its own latch, frame table and LRU queue
+// Every shard has a budget of at least 64 pages (256KB), smaller buffer pools have fewer shards
+inline constexpr size_t kBufferPoolShards = 16;
+inline constexpr size_t kMinShardPages = 64;
+
+// 2Q keeps the pages read once in a FIFO queue of up to 1/4 of the shard
+// and remembers the ids of as many pages as 1/2 of the shard evicted from that queue
+inline constexpr double kTwoQInRatio = 0.25;
+inline constexpr double kTwoQOutRatio = 0.5;
+
+// LRU-2 evicts the page whose second most recent read is the oldest
+// The reads of as many evicted pages as the shard caches are remembered
+inline constexpr size_t kLruK = 2;
+
+// The frame table starts with 64 slots and doubles when over half of them are taken
+inline constexpr size_t kMinFrameTableSlots = 64;
+inline constexpr double kMaxFrameTableLoad = 0.5;
+
+
+//------------ Table Cache ------------
+
+// Max number of SST files kept open at the same time
+inline constexpr size_t kMaxOpenFiles = 512;
+
+
+//------------ Async Reads ------------
+
+// Page reads of a batch are in flight together, up to 64 per io_uring
+inline constexpr unsigned kIoUringEntries = 64;
+
+// Without io_uring, 8 threads read the pages of a batch with pread
+inline constexpr size_t kIoThreads = 8;
+
+
+//------------ Readahead ------------
+
+// A cursor reading the pages of an SST in order first reads 4 pages at once, 16KB
+inline constexpr size_t kReadaheadMinPages = 4;
+
+// The window doubles while the cursor stays sequential, up to 64 pages, 256KB
+inline constexpr size_t kReadaheadMaxPages = 64;
+
 
 //------------ B-Tree SSTable ------------
 
 // Let B-Tree fan out be 1 page
 inline constexpr size_t kFanOut = kPagePairs; // 256
 
+// Every B-Tree SSTable ends with a footer of 10 int64_t
+inline constexpr size_t kFooterSize = 10 * sizeof(int64_t); // 80 Bytes
+
+// Magic number at the start of the footer, "LESTYKV2"
+inline constexpr int64_t kFooterMagic = 0x4c455354594b5632;
+
+// A bit-packed leaf holds at most 4 times the pairs of a raw leaf, 16KB once decoded
+inline constexpr size_t kMaxBitPackedLeafPairs = 4 * kPagePairs; // 1024
+
+// Even with 64 bits per key gap and value, a bit-packed leaf that is not the last one holds 255 pairs
+inline constexpr size_t kMinBitPackedLeafPairs = kPagePairs - 1; // 255
+
+
+//------------ Bloom Filter ------------
+
+// 10 bits per key gives a false positive rate of about 1%
+inline constexpr size_t kBloomBitsPerKey = 10;
+
+inline constexpr uint32_t kBloomSeed = 0xbc9f1d34;
+
 
 //------------ LSM-Tree ------------
 
@@ -70,4 +136,31 @@ inline constexpr size_t kLsmRatio = 3;
 inline constexpr size_t kLevelToApplyDostoevsky = 4;
 
 
+//------------ Compaction ------------
+
+// Number of worker threads merging levels in the background
+inline constexpr size_t kMaxBackgroundCompactions = 2;
+
+// When level 0 holds 3 * 3 = 9 SSTs, memtables are not flushed until merges catch up
+// Otherwise writes outrun merges and every read probes a growing number of SSTs
+inline constexpr size_t kLevel0StopWritesTrigger = 3 * kLsmRatio;
+
+// A merge is split into at most 4 key sub-ranges merged on their own threads
+inline constexpr size_t kMaxSubcompactions = 4;
+
+// Every sub-range takes at least 64 leaves (256KB) of the inputs, smaller merges are not split
+inline constexpr size_t kMinSubcompactionLeaves = 64;
+
+
+//------------ Write-Ahead Log ------------
+
+// In WalSyncMode::kInterval, the log is synced every 100 ms
+inline constexpr size_t kWalSyncIntervalMs = 100;
+
+// Writers queued behind the one writing the log join its group, up to 1MB of pairs
+inline constexpr size_t kMaxGroupCommitSize = 1024 * 1024; // 1MB
+
+inline constexpr uint32_t kWalChecksumSeed = 0x5741ac17;
+
+
 #endif // CONSTANTS_H